@@ -0,0 +1,838 @@
+//
+//  main.cpp
+//  ofxOssia-benchmark
+//
+//  Headless microbenchmarks of the ofxOssia hot paths (no window, no GL)
+//  Usage: ofxOssia-benchmark [number of parameters for the tree benchmarks, default 10000]
+//
+
+#include "ofxOssia.h"
+#include <atomic>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//========================================================================
+// Allocation counting: every operator new of the process goes through here
+
+namespace
+{
+std::atomic<std::size_t> allocations{0};
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+volatile bool sink;
+
+void report(const std::string& name, std::size_t operations, clock_type::duration time, std::size_t allocated)
+{
+    const double ns = std::chrono::duration<double, std::nano>(time).count() / operations;
+    std::printf("%-56s %10.1f ns/op %8.2f allocs/op %10.3f Mop/s\n",
+                name.c_str(), ns, double(allocated) / operations, 1e3 / ns);
+}
+
+// Runs f(i) for i in [0, iterations) after a short warm-up
+template<typename Function>
+void bench(const std::string& name, std::size_t iterations, Function&& f)
+{
+    for(std::size_t i = 0; i < iterations / 10; i++)
+        f(i);
+
+    const std::size_t allocated = allocations.load();
+    const auto start = clock_type::now();
+    for(std::size_t i = 0; i < iterations; i++)
+        f(i);
+    const auto end = clock_type::now();
+
+    report(name, iterations, end - start, allocations.load() - allocated);
+}
+
+// Runs f() once, which performs operations operations
+template<typename Function>
+void benchOnce(const std::string& name, std::size_t operations, Function&& f)
+{
+    const std::size_t allocated = allocations.load();
+    const auto start = clock_type::now();
+    f();
+    const auto end = clock_type::now();
+
+    report(name, operations, end - start, allocations.load() - allocated);
+}
+
+int failures = 0;
+
+// Counts and prints a failed check: main() then returns a non-zero status
+void expect(bool condition, const std::string& what)
+{
+    if(!condition)
+    {
+        std::printf("FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+// Conversions of MatchingType<T>, as done on each publish and each remote value
+template<typename T, typename Traits = ossia::MatchingType<T>>
+void benchConversion(const std::string& type, T a)
+{
+    using ossia_type = Traits;
+    const std::size_t iterations = 500000;
+    const opp::value v{ossia_type::convert(a)};
+
+    bench(type + " convert to opp::value", iterations, [&] (std::size_t) {
+        opp::value converted{ossia_type::convert(a)};
+        sink = converted.is_impulse();
+    });
+
+    bench(type + " is_valid + convertFromOssia", iterations, [&] (std::size_t) {
+        sink = ossia_type::is_valid(v) && !ossia::equals(ossia_type::convertFromOssia(v), a);
+    });
+}
+
+// Local changes: Parameter::set() (listener + publish) and Parameter::update()
+template<typename T, typename Traits = ossia::MatchingType<T>>
+void benchLocal(const std::string& type, ofxOssia& ossia, T a, T b)
+{
+    using ossia_type = Traits;
+    const std::size_t iterations = 200000;
+
+    ossia::Parameter<T, Traits> param;
+    param.setup(ossia.get_root_node(), type, a);
+    opp::node node = *param.getAddress();
+
+    // what Parameter::listen() used to do before publishing
+    bench(type + " node read + convert", iterations, [&] (std::size_t) {
+        opp::value v = node.get_value();
+        sink = ossia_type::is_valid(v) && !ossia::equals(ossia_type::convertFromOssia(v), a);
+    });
+
+    bench(type + " set, unchanged value", iterations, [&] (std::size_t) {
+        param.set(a);
+    });
+
+    bench(type + " set, changed value", iterations, [&] (std::size_t i) {
+        param.set(i & 1 ? a : b);
+    });
+
+    bench(type + " update", iterations, [&] (std::size_t i) {
+        param.update(i & 1 ? a : b);
+    });
+
+    ossia.beginBatch();
+    bench(type + " set while batching + flush", iterations, [&] (std::size_t i) {
+        param.set(i & 1 ? a : b);
+        ossia.flush();
+    });
+    ossia.endBatch();
+}
+
+// Remote values: a set_value() on the node goes through the same callback
+// as a value received from the network
+template<typename T, typename Traits = ossia::MatchingType<T>>
+void benchRemote(const std::string& type, ofxOssia& ossia, T a, T b)
+{
+    using ossia_type = Traits;
+    const std::size_t iterations = 100000;
+
+    ossia::Parameter<T, Traits> param;
+    param.setup(ossia.get_root_node(), type, a);
+    opp::node node = *param.getAddress();
+    const opp::value va{ossia_type::convert(a)};
+    const opp::value vb{ossia_type::convert(b)};
+
+    ossia.setInboundMode(ossia::InboundMode::Immediate);
+    bench(type + " remote inject, immediate", iterations, [&] (std::size_t i) {
+        node.set_value(i & 1 ? va : vb);
+    });
+
+    ossia.setInboundMode(ossia::InboundMode::Queued);
+    bench(type + " remote inject, queued + drain", iterations, [&] (std::size_t i) {
+        node.set_value(i & 1 ? va : vb);
+        ossia.drainInbound();
+    });
+
+    param.setCoalesced(true);
+    bench(type + " remote inject x16, coalesced + drain", iterations / 16, [&] (std::size_t) {
+        for(int k = 0; k < 16; k++)
+            node.set_value(k & 1 ? va : vb);
+        ossia.drainInbound();
+    });
+    param.setCoalesced(false);
+    ossia.setInboundMode(ossia::InboundMode::Immediate);
+}
+
+template<typename T, typename Traits = ossia::MatchingType<T>>
+void benchType(const std::string& type, ofxOssia& ossia, T a, T b)
+{
+    benchConversion<T, Traits>(type, a);
+    benchLocal<T, Traits>(type, ossia, a, b);
+    benchRemote<T, Traits>(type, ossia, a, b);
+}
+
+// Remote values of another type, converted by the lenient conversions of the parameter type
+template<typename T>
+void benchLenient(const std::string& name, ofxOssia& ossia, T init, opp::value a, opp::value b)
+{
+    ossia::Parameter<T> param;
+    param.setup(ossia.get_root_node(), name, init);
+    opp::node node = *param.getAddress();
+
+    bench(name + " remote inject, lenient", 100000, [&] (std::size_t i) {
+        node.set_value(i & 1 ? a : b);
+    });
+}
+
+// Values that do not fit in a float: largest error after a round trip through the node
+// (must be 0 when lossless, also with a comma as decimal separator),
+// and number of publications caused by remote values coming back (must be 0)
+template<typename Traits>
+void checkDouble(const std::string& type, ofxOssia& ossia)
+{
+    ossia::Parameter<double, Traits> param;
+    param.setup(ossia.get_root_node(), type + " precision", 0.);
+    opp::node node = *param.getAddress();
+    const bool lossless = std::is_same<Traits, ossia::LosslessDouble>::value;
+
+    const auto roundTrip = [&] (const std::string& name) {
+        double error = 0.;
+        uint64_t republished = 0;
+        for(int i = 0; i < 1000; i++)
+        {
+            const double value = 1234567.0 + i / 3.;
+            param.set(value);
+            error = std::max(error, std::abs(Traits::convertFromOssia(node.get_value()) - value));
+
+            const uint64_t published = ossia::Stats::read(param.getStats().published);
+            node.set_value(Traits::convert(value));
+            republished += ossia::Stats::read(param.getStats().published) - published;
+        }
+        std::printf("%-56s max error %g, republished %llu\n", name.c_str(),
+                    error, (unsigned long long)republished);
+        expect(!lossless || error == 0., name + ": lossless values must read back exactly");
+        expect(republished == 0, name + ": remote values must not be published back");
+    };
+
+    roundTrip(type + " round trip");
+    if(std::setlocale(LC_NUMERIC, "de_DE.UTF-8") || std::setlocale(LC_NUMERIC, "fr_FR.UTF-8"))
+    {
+        roundTrip(type + " round trip, comma locale");
+        std::setlocale(LC_NUMERIC, "C");
+    }
+
+    if(lossless)
+    {
+        // a string that is not a number is a type mismatch, the value stays
+        const double value = param.get();
+        const uint64_t mismatches = ossia::Stats::read(param.getStats().mismatches);
+        node.set_value(opp::value(std::string("not a number")));
+        expect(param.get() == value && ossia::Stats::read(param.getStats().mismatches) == mismatches + 1,
+               type + ": a string that is not a number must be counted as a mismatch");
+    }
+}
+
+// A value saved for a float is not loaded into an int created since at the same address
+void checkSnapshotTypes(ofxOssia& ossia)
+{
+    const std::string snapshot = "ofxOssia-benchmark-types.snapshot";
+    {
+        ossia::Parameter<float> param;
+        param.setup(ossia.get_root_node(), "snapshot type", 1.5f);
+        ossia.saveSnapshot(snapshot);
+    }
+    ossia::Parameter<int> param;
+    param.setup(ossia.get_root_node(), "snapshot type", 7);
+    ossia.loadSnapshot(snapshot);
+    std::remove(snapshot.c_str());
+    expect(param.get() == 7, "loadSnapshot: the value of a float must not be loaded into an int");
+}
+
+// Values sent and received by each kind of change, counted on the node itself:
+// exactly one set_value per local change, update() or remote value,
+// published once for the first two and never for the third, and never received back
+void checkOrigins(ofxOssia& ossia)
+{
+    ossia::Parameter<float> param;
+    param.setup(ossia.get_root_node(), "origins", 0.f);
+    opp::node node = *param.getAddress();
+    const std::string path = ossia::relativeAddress(node.get_address());
+    const ossia::Stats& stats = param.getStats();
+
+    // every set_value on the node, whoever makes it, goes through its value callbacks
+    uint64_t setValues = 0;
+    const opp::callback_index counter = node.set_value_callback([] (void* context, const opp::value&) {
+        ++*static_cast<uint64_t*>(context);
+    }, &setValues);
+
+    const auto check = [&] (const std::string& change, uint64_t publications, uint64_t receptions, auto apply) {
+        const std::string name = path + ", " + change;
+        const uint64_t calls = setValues;
+        const uint64_t published = ossia::Stats::read(stats.published);
+        const uint64_t received = ossia::Stats::read(stats.received);
+        const int iterations = 1000;
+        for(int i = 0; i < iterations; i++)
+            apply(i);
+
+        const uint64_t c = setValues - calls;
+        const uint64_t p = ossia::Stats::read(stats.published) - published;
+        const uint64_t r = ossia::Stats::read(stats.received) - received;
+        std::printf("%-56s set_value %.2f, published %.2f, received %.2f\n", (name + ", per change").c_str(),
+                    double(c) / iterations, double(p) / iterations, double(r) / iterations);
+        expect(c == uint64_t(iterations), name + ": one set_value per change");
+        expect(p == publications * iterations, name + ": published " + std::to_string(publications) + " time(s) per change");
+        expect(r == receptions * iterations, name + ": received " + std::to_string(receptions) + " time(s) per change");
+    };
+
+    check("local set", 1, 0, [&] (int i) { param.set(float(i + 1)); });
+    check("update", 1, 0, [&] (int i) { param.update(float(-i - 1)); });
+    check("remote value", 0, 1, [&] (int i) { node.set_value(opp::value(float(i) + 0.5f)); });
+
+    node.remove_value_callback(counter);
+}
+
+// Values queued for a parameter destroyed before drainInbound(): rejected by their handle
+void checkStale(ofxOssia& ossia)
+{
+    ossia.setInboundMode(ossia::InboundMode::Queued);
+    const uint64_t stale = ossia::SlotTable::instance().getStaleCount();
+    {
+        ossia::Parameter<float> param;
+        param.setup(ossia.get_root_node(), "stale", 0.f);
+        opp::node node = *param.getAddress();
+        for(int i = 0; i < 100; i++)
+            node.set_value(opp::value(float(i)));
+    }
+    const std::size_t drained = ossia.drainInbound();
+    const uint64_t rejected = ossia::SlotTable::instance().getStaleCount() - stale;
+    std::printf("%-56s drained %zu, rejected %llu\n", "values queued for a destroyed parameter", drained,
+                (unsigned long long)rejected);
+    expect(rejected == 100, "SlotTable: every value queued for a destroyed parameter must be rejected");
+    expect(ossia.getInboundQueueDepth() == 0, "InboundQueue: the values of a destroyed parameter must be drained");
+    ossia.setInboundMode(ossia::InboundMode::Immediate);
+}
+
+// A 640x480 RGB frame packed into a 64 pixels wide thumbnail, reusing the buffer
+void benchThumbnail()
+{
+    ofPixels frame;
+    frame.allocate(640, 480, 3);
+    ofBuffer buffer;
+    ofPixels thumbnail;
+
+    bench("packThumbnail 640x480 -> 64x48", 20000, [&] (std::size_t) {
+        ossia::packThumbnail(frame, 64, buffer);
+    });
+
+    bench("unpackThumbnail 64x48", 20000, [&] (std::size_t) {
+        sink = ossia::unpackThumbnail(buffer, thumbnail);
+    });
+}
+
+// Same layout as example-simple: groups of a few parameters
+struct Leaf
+{
+    ossia::ParameterGroup group;
+    ossia::Parameter<float> radius;
+    ossia::Parameter<ofVec2f> position;
+    ossia::Parameter<ofColor> color;
+    ossia::Parameter<bool> fill;
+
+    static constexpr std::size_t parameters = 4;
+
+    void setup(ossia::ParameterGroup& parent)
+    {
+        group.setup(parent, "circle");
+        radius.setup(group, "radius", 50.f, 1.f, 100.f);
+        position.setup(group, "position", ofVec2f(0, 0), ofVec2f(0, 0), ofVec2f(1024, 768));
+        color.setup(group, "color", ofColor(255, 255, 255, 255), ofColor(0, 0, 0, 0), ofColor(255, 255, 255, 255));
+        fill.setup(group, "fill", false);
+    }
+};
+
+// std::vector moves its elements when growing only if the move can't throw
+static_assert(std::is_nothrow_move_constructible<Leaf>::value, "Leaf must be nothrow movable");
+
+void benchTree(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves * Leaf::parameters) + " parameters)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "tree");
+
+    // deque: leaves never move once set up
+    std::deque<Leaf> circles(leaves);
+    benchOnce("tree creation" + suffix, leaves * Leaf::parameters, [&] {
+        for(auto& circle : circles)
+            circle.setup(tree);
+    });
+
+    benchOnce("set every parameter" + suffix, leaves * Leaf::parameters, [&] {
+        for(auto& circle : circles)
+        {
+            circle.radius.set(circle.radius + 1.f);
+            circle.position.set(circle.position.get() + ofVec2f(1, 1));
+            circle.color.set(ofColor(0, 0, 0, 255));
+            circle.fill.set(!circle.fill);
+        }
+    });
+
+    ossia.beginBatch();
+    benchOnce("set every parameter, batched" + suffix, leaves * Leaf::parameters, [&] {
+        for(auto& circle : circles)
+        {
+            circle.radius.set(circle.radius + 1.f);
+            circle.position.set(circle.position.get() + ofVec2f(1, 1));
+            circle.color.set(ofColor(255, 0, 0, 255));
+            circle.fill.set(!circle.fill);
+        }
+        ossia.flush();
+    });
+    ossia.endBatch();
+
+    const std::string snapshot = "ofxOssia-benchmark.snapshot";
+    benchOnce("saveSnapshot" + suffix, leaves * Leaf::parameters, [&] {
+        ossia.saveSnapshot(snapshot);
+    });
+    for(auto& circle : circles)
+        circle.radius.set(1.f);
+    std::size_t loaded = 0;
+    benchOnce("loadSnapshot" + suffix, leaves * Leaf::parameters, [&] {
+        loaded = ossia.loadSnapshot(snapshot);
+    });
+    std::printf("%-56s %zu\n", "loadSnapshot values loaded", loaded);
+    std::remove(snapshot.c_str());
+
+    benchOnce("tree teardown" + suffix, leaves * Leaf::parameters, [&] {
+        circles.clear();
+    });
+
+    circles.resize(leaves);
+    for(auto& circle : circles)
+        circle.setup(tree);
+    benchOnce("tree teardown, ParameterGroup::teardown()" + suffix, leaves * Leaf::parameters, [&] {
+        tree.teardown();
+        circles.clear();
+    });
+}
+
+// Leaves set up and then moved around by a growing vector: the registrations must follow
+void benchMoves(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves * Leaf::parameters) + " parameters)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "moved");
+
+    std::vector<Leaf> circles;
+    benchOnce("set up in a growing vector" + suffix, leaves * Leaf::parameters, [&] {
+        for(std::size_t i = 0; i < leaves; i++)
+        {
+            circles.emplace_back();
+            circles.back().setup(tree);
+        }
+    });
+
+    std::vector<Leaf> moved;
+    moved.reserve(leaves);
+    benchOnce("move every leaf" + suffix, leaves * Leaf::parameters, [&] {
+        for(auto& circle : circles)
+            moved.push_back(std::move(circle));
+    });
+    circles.clear();
+
+    // remote values still reach the moved parameters
+    std::size_t reached = 0;
+    for(auto& circle : moved)
+    {
+        circle.radius.getAddress()->set_value(opp::value(42.f));
+        reached += circle.radius.get() == 42.f;
+    }
+    std::printf("%-56s %zu / %zu\n", "moved parameters reached by remote values", reached, moved.size());
+    expect(reached == moved.size(), "Parameter: remote values must reach the moved parameters");
+
+    // moved-from parameters: copied, assigned from and set up again as new ones
+    ossia::Parameter<float> source;
+    source.setup(tree, "source", 1.f);
+    ossia::Parameter<float> taken{std::move(source)};
+    expect(source.getAddress() == nullptr, "Parameter: a moved-from parameter must have no node");
+
+    ossia::Parameter<float> copied{source};
+    ossia::Parameter<float> assigned;
+    assigned.setup(tree, "assigned", 2.f);
+    assigned = source;
+    expect(copied.getAddress() && !*copied.getAddress(), "Parameter: a copy of a moved-from parameter must be a new one");
+    expect(assigned.getAddress() && !*assigned.getAddress(), "Parameter: assigning a moved-from parameter must give a new one");
+    copied.set(3.f);
+    assigned.set(4.f);
+    expect(taken.get() == 1.f, "Parameter: a copy of a moved-from parameter must not share the value of the moved one");
+
+    source.setup(tree, "source again", 5.f);
+    expect(source.getAddress() && *source.getAddress() && taken.get() == 1.f,
+           "Parameter: a moved-from parameter must be set up again on its own");
+    taken.getAddress()->set_value(opp::value(42.f));
+    expect(taken.get() == 42.f && source.get() == 5.f, "Parameter: remote values must reach the moved parameter only");
+
+    // moved-from groups: no node nor context, set up again as new ones
+    ossia::ParameterGroup group;
+    group.setup(tree, "group");
+    ossia::ParameterGroup takenGroup{std::move(group)};
+    ossia::ParameterGroup copiedGroup{group};
+    expect(!group.getNode() && !group.getContext() && !copiedGroup.getNode(),
+           "ParameterGroup: a moved-from group must have no node nor context");
+    expect(group.setAll("radius", 0.f) == 0, "ParameterGroup: setAll() on a moved-from group must set nothing");
+    group.teardown();
+
+    group.setup(tree, "group again");
+    ossia::Parameter<float> inner;
+    inner.setup(group, "inner", 0.f);
+    expect(group.getNode() && group.getContext() && takenGroup.size() == 0,
+           "ParameterGroup: a moved-from group must be set up again on its own");
+
+    tree.teardown();
+    moved.clear();
+}
+
+// Parameters looked up by address, as a show control script would do every frame
+void benchFind(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves) + " lookups)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "find");
+    std::deque<Leaf> circles(leaves);
+    for(auto& circle : circles)
+        circle.setup(tree);
+
+    std::vector<std::string> paths;
+    for(auto& circle : circles)
+        paths.push_back(ossia::relativeAddress(circle.radius.getAddress()->get_address()));
+    const std::vector<ossia::Address> addresses(paths.begin(), paths.end());
+
+    opp::node root = ossia.get_device().get_root_node();
+    std::size_t found = 0;
+    benchOnce("find_child" + suffix, leaves, [&] {
+        for(const auto& path : paths)
+            found += bool(root.find_child(path.substr(1)));
+    });
+    benchOnce("ofxOssia::find, string" + suffix, leaves, [&] {
+        for(const auto& path : paths)
+            found += ossia.find<float>(path) != nullptr;
+    });
+    benchOnce("ofxOssia::find, ossia::Address" + suffix, leaves, [&] {
+        for(const auto& address : addresses)
+            found += ossia.find<float>(address) != nullptr;
+    });
+    std::printf("%-56s %zu / %zu\n", "parameters found", found, 3 * leaves);
+
+    tree.teardown();
+    circles.clear();
+}
+
+// Setting one parameter of every circle: per parameter, then through a pattern
+void benchSetAll(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves) + " parameters)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "setall");
+    std::deque<Leaf> circles(leaves);
+    for(auto& circle : circles)
+        circle.setup(tree);
+
+    bool fill = false;
+    benchOnce("ofParameter::set() each" + suffix, leaves, [&] {
+        fill = !fill;
+        for(auto& circle : circles)
+            circle.fill.set(fill);
+    });
+    std::size_t set = 0;
+    benchOnce("ParameterGroup::setAll(), first call" + suffix, leaves, [&] {
+        fill = !fill;
+        set = tree.setAll("circle.*/fill", fill);
+    });
+    benchOnce("ParameterGroup::setAll(), cached" + suffix, leaves, [&] {
+        fill = !fill;
+        set = tree.setAll("circle.*/fill", fill);
+    });
+    std::printf("%-56s %zu / %zu\n", "parameters set", set, leaves);
+    expect(set == leaves, "setAll: every matching parameter must be set");
+
+    // other types and new parameters are not matched by a stale cache
+    expect(tree.setAll("circle.*/fill", 1.f) == 0, "setAll: parameters of another type must not be set");
+    Leaf extra;
+    extra.setup(tree);
+    expect(tree.setAll("circle.*/fill", true) == leaves + 1 && extra.fill.get(),
+           "setAll: a parameter added after the pattern was resolved must be set");
+
+    tree.teardown();
+    circles.clear();
+}
+
+// Same tree, created by ParameterGroup::build()
+void benchBuild(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves * Leaf::parameters) + " parameters)";
+
+    ossia::ParameterSchema schema;
+    schema.reserve(leaves * Leaf::parameters);
+    for(std::size_t i = 0; i < leaves; i++)
+    {
+        const std::string circle = "circle" + std::to_string(i) + "/";
+        schema.add(circle + "radius", 50.f, 1.f, 100.f);
+        schema.add(circle + "position", ofVec2f(0, 0), ofVec2f(0, 0), ofVec2f(1024, 768));
+        schema.add(circle + "color", ofColor(255, 255, 255, 255), ofColor(0, 0, 0, 0), ofColor(255, 255, 255, 255));
+        schema.add(circle + "fill", false);
+    }
+
+    // the same tree, one setup() per group and parameter
+    {
+        ossia::ParameterGroup tree;
+        tree.setup(ossia.get_root_node(), "manual");
+        std::deque<Leaf> circles(leaves);
+        benchOnce("manual setup" + suffix, leaves * Leaf::parameters, [&] {
+            for(auto& circle : circles)
+                circle.setup(tree);
+        });
+        tree.teardown();
+    }
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "built");
+    benchOnce("build" + suffix, leaves * Leaf::parameters, [&] {
+        tree.build(schema);
+    });
+
+    benchOnce("built tree teardown" + suffix, leaves * Leaf::parameters, [&] {
+        tree.teardown();
+    });
+}
+
+// Crossfade between two presets of the whole tree, one step per frame
+void benchPresets(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves * Leaf::parameters) + " parameters)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "presets");
+    std::deque<Leaf> circles(leaves);
+    for(auto& circle : circles)
+        circle.setup(tree);
+
+    ossia::PresetBank bank(tree);
+    const std::size_t from = bank.capture();
+    for(auto& circle : circles)
+    {
+        circle.radius.set(100.f);
+        circle.position.set(ofVec2f(1024, 768));
+        circle.color.set(ofColor(255, 0, 0, 255));
+        circle.fill.set(true);
+    }
+    const std::size_t to = bank.capture();
+
+    const std::size_t frames = 60;
+    benchOnce("preset crossfade, per frame" + suffix, frames, [&] {
+        for(std::size_t i = 0; i < frames; i++)
+            bank.crossfade(from, to, float(i) / (frames - 1));
+    });
+
+    benchOnce("preset recall" + suffix, leaves * Leaf::parameters, [&] {
+        bank.recall(from);
+    });
+
+    // a parameter added since the presets were captured: picked up without rescan(),
+    // the presets keeping the values of the others
+    Leaf extra;
+    extra.setup(tree);
+    extra.radius.set(25.f);
+    bank.recall(to);
+    expect(bank.getParameterCount() == (leaves + 1) * Leaf::parameters,
+           "PresetBank: the parameters added to the device must be found again");
+    expect(leaves == 0 || circles.front().radius.get() == 100.f,
+           "PresetBank: the presets must keep their values across a rescan");
+    expect(extra.radius.get() == 25.f, "PresetBank: a new parameter must keep its current value");
+
+    tree.teardown();
+    circles.clear();
+}
+
+// Traffic recorded while values are injected in the tree, then replayed as fast as possible
+void benchTraffic(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::size_t rounds = 10;
+    const std::string suffix = " (" + std::to_string(leaves * rounds) + " values)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "traffic");
+    std::deque<Leaf> circles(leaves);
+    for(auto& circle : circles)
+        circle.setup(tree);
+
+    std::vector<opp::node> nodes;
+    for(auto& circle : circles)
+        nodes.push_back(*circle.radius.getAddress());
+
+    const auto inject = [&] {
+        for(std::size_t r = 0; r < rounds; r++)
+            for(std::size_t i = 0; i < nodes.size(); i++)
+                nodes[i].set_value(opp::value(float(r + i)));
+    };
+
+    benchOnce("remote inject" + suffix, leaves * rounds, inject);
+
+    const std::string log = "ofxOssia-benchmark.traffic";
+    ossia.startRecording(log);
+    benchOnce("remote inject, recording" + suffix, leaves * rounds, inject);
+    ossia.stopRecording();
+
+    ossia::TrafficReplayer replayer;
+    benchOnce("traffic log load" + suffix, leaves * rounds, [&] {
+        replayer.load(log, ossia.get_device().get_root_node());
+    });
+    std::size_t replayed = 0;
+    benchOnce("traffic replay, as fast as possible" + suffix, leaves * rounds, [&] {
+        replayed = replayer.replay(0.f);
+    });
+    std::printf("%-56s %zu\n", "traffic values replayed", replayed);
+    expect(replayed == leaves * rounds, "TrafficRecorder: every value recorded must be written to the log");
+    std::remove(log.c_str());
+
+    tree.teardown();
+    circles.clear();
+}
+
+// The device mirrors itself through its websocket port
+void benchMirror(ofxOssia& ossia, std::size_t count)
+{
+    const std::size_t leaves = count / Leaf::parameters;
+    const std::string suffix = " (" + std::to_string(leaves * Leaf::parameters) + " parameters)";
+
+    ossia::ParameterGroup tree;
+    tree.setup(ossia.get_root_node(), "mirrored");
+    std::deque<Leaf> circles(leaves);
+    for(auto& circle : circles)
+        circle.setup(tree);
+
+    ofxOssiaMirror mirror;
+    benchOnce("mirror setup" + suffix, leaves * Leaf::parameters, [&] {
+        mirror.setup("ofxOssiaBenchmark", "ws://127.0.0.1:5679");
+    });
+
+    std::size_t changes = 0;
+    benchOnce("mirror refresh, nothing changed" + suffix, leaves * Leaf::parameters, [&] {
+        changes = mirror.refresh();
+    });
+    std::printf("%-56s %zu\n", "mirror refresh changes", changes);
+
+    tree.teardown();
+    circles.clear();
+}
+}
+
+//========================================================================
+int main(int argc, char** argv){
+
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+
+    ofxOssia ossia;
+    ossia.setup("ofxOssiaBenchmark", 3457, 5679);
+
+    std::printf("== parameter types ==\n");
+    benchType<float>("float", ossia, 0.f, 1.f);
+    benchType<int>("int", ossia, 0, 1);
+    benchType<bool>("bool", ossia, false, true);
+    benchType<double>("double", ossia, 0., 1.);
+    benchType<double, ossia::LosslessDouble>("double, lossless", ossia, 0., 1.);
+    benchType<ofVec2f>("ofVec2f", ossia, ofVec2f(0, 0), ofVec2f(1, 2));
+    benchType<ofVec3f>("ofVec3f", ossia, ofVec3f(0, 0, 0), ofVec3f(1, 2, 3));
+    benchType<ofVec4f>("ofVec4f", ossia, ofVec4f(0, 0, 0, 0), ofVec4f(1, 2, 3, 4));
+    benchType<glm::vec2>("glm::vec2", ossia, glm::vec2(0, 0), glm::vec2(1, 2));
+    benchType<glm::vec3>("glm::vec3", ossia, glm::vec3(0, 0, 0), glm::vec3(1, 2, 3));
+    benchType<glm::vec4>("glm::vec4", ossia, glm::vec4(0, 0, 0, 0), glm::vec4(1, 2, 3, 4));
+    benchType<glm::quat>("glm::quat", ossia, glm::quat(1, 0, 0, 0), glm::quat(0, 1, 0, 0));
+    benchType<ofQuaternion>("ofQuaternion", ossia, ofQuaternion(0, 0, 0, 1), ofQuaternion(1, 0, 0, 0));
+    benchType<glm::mat4>("glm::mat4", ossia, glm::mat4(1.f), glm::mat4(2.f));
+    benchType<ofMatrix4x4>("ofMatrix4x4", ossia, ofMatrix4x4(), ofMatrix4x4::newScaleMatrix(2, 2, 2));
+    benchType<ofRectangle>("ofRectangle", ossia, ofRectangle(0, 0, 1, 1), ofRectangle(10, 20, 640, 480));
+    benchType<ofColor>("ofColor", ossia, ofColor(0, 0, 0, 255), ofColor(255, 128, 0, 255));
+    benchType<ofFloatColor>("ofFloatColor", ossia, ofFloatColor(0, 0, 0, 1), ofFloatColor(1, 0.5, 0, 1));
+    benchType<std::string>("string", ossia, std::string("a string long enough to be on the heap"), std::string("bar"));
+    benchType<std::vector<float>>("vector<float>[512]", ossia, std::vector<float>(512, 0.f), std::vector<float>(512, 1.f));
+    benchType<std::vector<int>>("vector<int>[128]", ossia, std::vector<int>(128, 0), std::vector<int>(128, 1));
+    const std::string zeros(4096, '\0'), ones(4096, '\1');
+    benchType<ofBuffer>("ofBuffer[4096]", ossia, ofBuffer(zeros.data(), zeros.size()), ofBuffer(ones.data(), ones.size()));
+    benchThumbnail();
+
+    std::printf("== lenient conversions ==\n");
+    benchLenient<float>("int to float", ossia, 0.f, opp::value(0), opp::value(1));
+    benchLenient<bool>("float to bool", ossia, false, opp::value(0.f), opp::value(1.f));
+    benchLenient<ofColor>("vec3f to ofColor", ossia, ofColor(), opp::value(opp::value::vec3f{{0, 0, 0}}), opp::value(opp::value::vec3f{{1, 0.5f, 0}}));
+
+    std::printf("== double precision ==\n");
+    checkDouble<ossia::MatchingType<double>>("double", ossia);
+    checkDouble<ossia::LosslessDouble>("double, lossless", ossia);
+    checkSnapshotTypes(ossia);
+
+    std::printf("== origins ==\n");
+    checkOrigins(ossia);
+    checkStale(ossia);
+
+    std::printf("== tree ==\n");
+    benchTree(ossia, count);
+
+    std::printf("== moves ==\n");
+    benchMoves(ossia, count);
+
+    std::printf("== find ==\n");
+    benchFind(ossia, count);
+
+    std::printf("== setAll ==\n");
+    benchSetAll(ossia, count);
+
+    std::printf("== build ==\n");
+    for(std::size_t n : {1000, 10000, 100000})
+        benchBuild(ossia, n);
+
+    std::printf("== presets ==\n");
+    benchPresets(ossia, count);
+
+    std::printf("== traffic ==\n");
+    benchTraffic(ossia, count);
+
+    std::printf("== mirror ==\n");
+    benchMirror(ossia, count);
+
+    if(failures)
+        std::printf("%d check(s) failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -16,6 +16,9 @@ void ofApp::setup(){
     // but specific name and ports can be provided:
     ossia.setup("ofxOssiaTest", 3124, 7539);
 
+    // values coming from the network are applied in update(), on the main thread
+    ossia.setInboundMode(ossia::InboundMode::Queued);
+
     // here we setup 10 InteractiveCircle instances
     for (int i=0 ; i<10 ; i++){
         InteractiveCircle circle;
@@ -31,7 +34,7 @@ void ofApp::setup(){
 
 //--------------------------------------------------------------
 void ofApp::update(){
-
+    ossia.drainInbound();
 }
 
 //--------------------------------------------------------------
@@ -57,6 +60,8 @@ void ofApp::keyPressed(int key){
     }
     else if (key == '-'){
         for (int i=0 ; i<5 && circles.size()>1 ; i++){
+            // removes the whole circle subtree at once
+            circles.back().getCircleParams().teardown();
             circles.pop_back();
         }
     }
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+namespace ossia
+{
+
+class ParamNode;
+
+/*
+ * Address of a parameter relative to the device ("/circle/radius"), with its hash
+ * Scripts addressing the same parameters every frame can keep Address objects
+ * to skip hashing the string at each lookup
+ **/
+
+struct Address
+{
+  std::string path;
+  std::size_t hash{};
+
+  Address() = default;
+  Address(std::string p):
+    path(std::move(p)), hash(std::hash<std::string>{}(path))
+  {
+  }
+  Address(const char* p):
+    Address(std::string(p))
+  {
+  }
+
+  bool operator==(const Address& other) const
+  {
+    return hash == other.hash && path == other.path;
+  }
+
+  struct Hash
+  {
+    std::size_t operator()(const Address& a) const { return a.hash; }
+  };
+};
+
+/*
+ * Parameters of a device by address (main thread only)
+ * Filled by Parameter::setup() and attach(), an entry goes away with its parameter
+ **/
+
+class AddressIndex
+{
+public:
+  struct Entry
+  {
+    ParamNode* node;
+    const std::type_info* type; // of the ofParameter
+    void* parameter;            // ofParameter<type> sharing the value of the Parameter
+  };
+
+  // A newer parameter at the same address replaces the older one
+  void insert(const Address& address, const Entry& entry)
+  {
+    _entries[address] = entry;
+    _version++;
+  }
+
+  void erase(const Address& address, const ParamNode* node)
+  {
+    auto it = _entries.find(address);
+    if(it != _entries.end() && it->second.node == node)
+    {
+      _entries.erase(it);
+      _version++;
+    }
+  }
+
+  const Entry* find(const Address& address) const
+  {
+    auto it = _entries.find(address);
+    return it != _entries.end() ? &it->second : nullptr;
+  }
+
+  std::size_t size() const
+  {
+    return _entries.size();
+  }
+
+  // Changes each time a parameter is added or removed, e.g. to invalidate what was found in the index
+  uint64_t version() const
+  {
+    return _version;
+  }
+
+private:
+  std::unordered_map<Address, Entry, Address::Hash> _entries;
+  uint64_t _version{0};
+};
+
+} // namespace ossia
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace ossia
+{
+
+/*
+ * "Latest value wins" slot between the network threads and the main thread
+ * Triple buffer: writers never wait for the reader, the reader never waits at all
+ * Only the last value stored before take() is seen, the others are counted as collapsed
+ **/
+
+template<typename T>
+class CoalescingSlot
+{
+public:
+  CoalescingSlot() = default;
+  CoalescingSlot(const CoalescingSlot&) = delete;
+  CoalescingSlot& operator=(const CoalescingSlot&) = delete;
+
+  // Any thread: returns true when the slot was empty,
+  // i.e. when the caller has to schedule a take() on the main thread
+  bool store(T&& value)
+  {
+    // writers are serialized between themselves only (e.g. OSC and WS threads)
+    while(_writing.test_and_set(std::memory_order_acquire))
+      ;
+    _buffers[_back] = std::move(value);
+    const unsigned prev = _middle.exchange(_back | dirty, std::memory_order_acq_rel);
+    _back = prev & index_mask;
+    _writing.clear(std::memory_order_release);
+
+    _received.fetch_add(1, std::memory_order_relaxed);
+    // the value stored before was never taken
+    if(prev & dirty)
+      _collapsed.fetch_add(1, std::memory_order_relaxed);
+    return !(prev & dirty) || _unscheduled.exchange(false, std::memory_order_relaxed);
+  }
+
+  // Any thread: the take() requested by store() could not be scheduled,
+  // the next store() will ask again
+  void unschedule()
+  {
+    _unscheduled.store(true, std::memory_order_relaxed);
+  }
+
+  // Main thread only: returns the latest value, or nullptr if nothing new was stored
+  // The pointer stays valid until the next take()
+  T* take()
+  {
+    if(!(_middle.load(std::memory_order_relaxed) & dirty))
+      return nullptr;
+
+    _front = _middle.exchange(_front, std::memory_order_acq_rel) & index_mask;
+    _applied.fetch_add(1, std::memory_order_relaxed);
+    return &_buffers[_front];
+  }
+
+  // Number of values received from the network
+  uint64_t received() const { return _received.load(std::memory_order_relaxed); }
+
+  // Number of values actually applied
+  uint64_t applied() const { return _applied.load(std::memory_order_relaxed); }
+
+  // Number of values overwritten before being applied
+  // (the value waiting for take(), if any, is not counted)
+  uint64_t collapsed() const { return _collapsed.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr unsigned dirty = 4;
+  static constexpr unsigned index_mask = 3;
+
+  T _buffers[3]{};
+  unsigned _back{0};                  // writers
+  std::atomic<unsigned> _middle{1};   // shared
+  unsigned _front{2};                 // reader
+
+  std::atomic_flag _writing = ATOMIC_FLAG_INIT;
+  std::atomic<bool> _unscheduled{false};
+  std::atomic<uint64_t> _received{0};
+  std::atomic<uint64_t> _applied{0};
+  std::atomic<uint64_t> _collapsed{0};
+};
+
+} // namespace ossia
@@ -0,0 +1,139 @@
+#pragma once
+#include "AddressIndex.h"
+#include "InboundQueue.h"
+#include "Stats.h"
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ossia
+{
+
+class ParamNode;
+class TrafficRecorder;
+
+/*
+ * How values received from the network are applied to the ofParameters
+ **/
+enum class InboundMode
+{
+  Immediate, // set() is called from the network thread (default)
+  Queued     // values wait in the device queue until ofxOssia::drainInbound()
+};
+
+/*
+ * State shared by all the nodes of an ofxOssia device
+ * Each ParamNode of the tree holds a reference to it
+ **/
+struct DeviceContext
+{
+  InboundQueue inbound;
+  std::atomic<InboundMode> inboundMode{InboundMode::Immediate};
+
+  bool queueInbound() const
+  {
+    return inboundMode.load(std::memory_order_relaxed) == InboundMode::Queued;
+  }
+
+  // Counters of all the parameters of the device
+  Stats stats;
+  // Measure the duration of remote callbacks (two clock reads per value)
+  std::atomic<bool> timeCallbacks{false};
+
+  // Log of the values received, see ofxOssia::startRecording()
+  // Owned by ofxOssia, which keeps it alive as long as the device
+  std::atomic<TrafficRecorder*> recorder{nullptr};
+
+  /*
+   * Outbound batching (main thread only)
+   * While batching, local changes only mark their parameter dirty,
+   * flush() then publishes every dirty parameter once
+   * Changes held back by a max rate wait in the dirty list as well
+   **/
+  struct DirtyEntry
+  {
+    void* target; // SlotTable handle of the parameter
+    bool (*publish)(void*); // returns false when the target must stay dirty
+  };
+
+  bool batching{false};
+  std::vector<DirtyEntry> dirty;
+  std::vector<DirtyEntry> deferred;
+
+  void markDirty(void* target, bool (*publish)(void*))
+  {
+    dirty.push_back({target, publish});
+  }
+
+  // Returns the number of parameters published
+  std::size_t flush()
+  {
+    std::size_t published = 0;
+    // publishing can mark other parameters dirty (e.g. from a listener): they go in the same flush
+    for(std::size_t i = 0; i < dirty.size(); i++)
+    {
+      const DirtyEntry entry = dirty[i];
+      if(entry.target)
+      {
+        if(entry.publish(entry.target))
+          published++;
+        else
+          deferred.push_back(entry);
+      }
+    }
+    dirty.clear();
+    dirty.swap(deferred);
+    return published;
+  }
+
+  /*
+   * Batches the changes made during its lifetime (e.g. a snapshot or preset recall),
+   * flushed at the end unless the device was already batching
+   **/
+  class ScopedBatch
+  {
+  public:
+    explicit ScopedBatch(DeviceContext* device):
+      _device(device), _batching(device && device->batching)
+    {
+      if(_device)
+        _device->batching = true;
+    }
+
+    ScopedBatch(const ScopedBatch&) = delete;
+    ScopedBatch& operator=(const ScopedBatch&) = delete;
+
+    ~ScopedBatch()
+    {
+      if(_device)
+      {
+        _device->batching = _batching;
+        if(!_batching)
+          _device->flush();
+      }
+    }
+
+  private:
+    DeviceContext* _device;
+    bool _batching;
+  };
+
+  /*
+   * Parameters of the device, for ofxOssia::saveSnapshot() / loadSnapshot() (main thread only)
+   * Registered by each parameter node when it is set up, removed when the node goes away
+   **/
+  struct SnapshotEntry
+  {
+    void (*save)(const ParamNode*, std::string& out);       // appends the value
+    bool (*load)(ParamNode*, const char* data, std::size_t size); // false when the data does not fit
+    uint32_t type;                                                 // snapshot::typeId() of the value
+  };
+
+  std::unordered_map<ParamNode*, SnapshotEntry> snapshotEntries;
+
+  // Parameters by address, see ofxOssia::find()
+  AddressIndex index;
+};
+
+} // namespace ossia
@@ -0,0 +1,240 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ossia
+{
+
+/*
+ * Bounded lock-free multi-producer / single-consumer ring
+ * Network threads push values already converted to their ofx type,
+ * the main thread applies them in drain()
+ * Values small enough are stored inline in the cell, bigger ones on the heap
+ * Parameters push a SlotTable handle as target: values left for a parameter
+ * cleaned up meanwhile are dropped by its Apply function
+ **/
+
+class InboundQueue
+{
+public:
+  static constexpr std::size_t inline_size = 64;
+
+  explicit InboundQueue(std::size_t capacity = 4096)
+  {
+    std::size_t size = 2;
+    while(size < capacity)
+      size <<= 1;
+
+    _cells.reset(new Cell[size]);
+    _mask = size - 1;
+    for(std::size_t i = 0; i < size; i++)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  InboundQueue(const InboundQueue&) = delete;
+  InboundQueue& operator=(const InboundQueue&) = delete;
+
+  ~InboundQueue()
+  {
+    // drop what was never applied
+    const std::size_t end = _tail.load(std::memory_order_acquire);
+    for(std::size_t pos = _head.load(std::memory_order_relaxed); pos != end; ++pos)
+    {
+      Cell& cell = _cells[pos & _mask];
+      if(cell.sequence.load(std::memory_order_acquire) == pos + 1)
+        cell.destroy(&cell.storage);
+    }
+  }
+
+  // Can be called from any thread, returns false (and drops the value) when the ring is full
+  template<typename T, void (*Apply)(void*, T&)>
+  bool push(void* target, T&& value)
+  {
+    using ops = Ops<T>;
+
+    std::size_t pos;
+    Cell* cell = claim(pos);
+    if(!cell)
+      return false;
+
+    cell->target = target;
+    cell->apply = &ops::template invoke<Apply>;
+    cell->destroy = &ops::destroy;
+    ops::construct(&cell->storage, std::forward<T>(value));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Same without value: Apply(target) will be called by drain()
+  template<void (*Apply)(void*)>
+  bool push(void* target)
+  {
+    std::size_t pos;
+    Cell* cell = claim(pos);
+    if(!cell)
+      return false;
+
+    cell->target = target;
+    cell->apply = &invokeSignal<Apply>;
+    cell->destroy = &destroyNothing;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Main thread only: applies the values queued so far, returns how many were applied
+  // Values pushed while draining (e.g. by a listener) wait for the next call
+  std::size_t drain()
+  {
+    std::size_t pos = _head.load(std::memory_order_relaxed);
+    const std::size_t end = _tail.load(std::memory_order_acquire);
+    std::size_t applied = 0;
+
+    while(pos != end)
+    {
+      Cell& cell = _cells[pos & _mask];
+      if(cell.sequence.load(std::memory_order_acquire) != pos + 1)
+        break; // a producer has not finished writing this cell yet
+
+      if(cell.target)
+      {
+        cell.apply(cell.target, &cell.storage);
+        applied++;
+      }
+      cell.destroy(&cell.storage);
+
+      cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+      _head.store(++pos, std::memory_order_relaxed);
+    }
+    return applied;
+  }
+
+  // Approximate number of values waiting
+  std::size_t size() const
+  {
+    return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed);
+  }
+
+  std::size_t capacity() const
+  {
+    return _mask + 1;
+  }
+
+  // Number of values lost because the ring was full
+  std::size_t dropped() const
+  {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  using storage_type = typename std::aligned_storage<inline_size, alignof(std::max_align_t)>::type;
+
+  struct Cell
+  {
+    std::atomic<std::size_t> sequence{};
+    void* target{};
+    void (*apply)(void*, void*){};
+    void (*destroy)(void*){};
+    storage_type storage;
+  };
+
+  Cell* claim(std::size_t& pos)
+  {
+    pos = _tail.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      Cell* cell = &_cells[pos & _mask];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      std::intptr_t dif = std::intptr_t(seq) - std::intptr_t(pos);
+      if(dif == 0)
+      {
+        if(_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          return cell;
+      }
+      else if(dif < 0)
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      else
+      {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  template<void (*Apply)(void*)>
+  static void invokeSignal(void* target, void*)
+  {
+    Apply(target);
+  }
+
+  static void destroyNothing(void*)
+  {
+  }
+
+  template<typename T>
+  struct Ops
+  {
+    static constexpr bool is_inline =
+        sizeof(T) <= inline_size
+        && alignof(T) <= alignof(storage_type)
+        && std::is_nothrow_move_constructible<T>::value;
+
+    template<typename U>
+    static void construct(void* storage, U&& value)
+    {
+      construct(storage, std::forward<U>(value), std::integral_constant<bool, is_inline>{});
+    }
+
+    static T& get(void* storage)
+    {
+      return get(storage, std::integral_constant<bool, is_inline>{});
+    }
+
+    static void destroy(void* storage)
+    {
+      destroy(storage, std::integral_constant<bool, is_inline>{});
+    }
+
+    template<void (*Apply)(void*, T&)>
+    static void invoke(void* target, void* storage)
+    {
+      Apply(target, get(storage));
+    }
+
+  private:
+    template<typename U>
+    static void construct(void* storage, U&& value, std::true_type)
+    { new(storage) T(std::forward<U>(value)); }
+
+    template<typename U>
+    static void construct(void* storage, U&& value, std::false_type)
+    { new(storage) T*(new T(std::forward<U>(value))); }
+
+    static T& get(void* storage, std::true_type)
+    { return *reinterpret_cast<T*>(storage); }
+
+    static T& get(void* storage, std::false_type)
+    { return **reinterpret_cast<T**>(storage); }
+
+    static void destroy(void* storage, std::true_type)
+    { reinterpret_cast<T*>(storage)->~T(); }
+
+    static void destroy(void* storage, std::false_type)
+    { delete *reinterpret_cast<T**>(storage); }
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  std::size_t _mask{};
+
+  alignas(64) std::atomic<std::size_t> _tail{0};
+  alignas(64) std::atomic<std::size_t> _head{0};
+  std::atomic<std::size_t> _dropped{0};
+};
+
+} // namespace ossia
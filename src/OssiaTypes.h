@@ -2,8 +2,32 @@
 #include <ossia-cpp98.hpp>
 #include <types/ofBaseTypes.h>
 #include <math/ofVectorMath.h>
+#include <math/ofQuaternion.h>
+#include <math/ofMatrix4x4.h>
+#include <types/ofRectangle.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <utils/ofFileUtils.h>
 #include <string>
 #include <array>
+#include <vector>
+#include <type_traits>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#if __cplusplus >= 201703L && __has_include(<charconv>)
+#include <charconv>
+#endif
 
 #undef Status
 #undef Bool
@@ -17,6 +41,9 @@ namespace ossia
 /**
  * These classes contain the conversion mechanism from and to
  * the compatible OSSIA & OpenFrameworks types.
+ * Conversions are on the callback hot path: each opp::value is read only once
+ * and nothing is taken by value when a reference will do.
+ * distance() is the largest difference between components, used by Parameter::setMinDelta()
  *
  */
 template<typename> struct MatchingType;
@@ -30,17 +57,22 @@ template<> struct MatchingType<float> {
     {return _parent.create_float(_name);}
 
 
-    static bool is_valid(opp::value v){ return v.is_float(); }
+    static bool is_valid(const opp::value& v){ return v.is_float(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
       return v.to_float();
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return float(f);
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::abs(double(a) - double(b));
+    }
 };
 
 
@@ -52,17 +84,22 @@ template<> struct MatchingType<int> {
                                       opp::node _parent)
     {return _parent.create_int(_name);}
 
-    static bool is_valid(opp::value v){ return v.is_int(); }
+    static bool is_valid(const opp::value& v){ return v.is_int(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
       return v.to_int();
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return int(f);
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::abs(double(a) - double(b));
+    }
 };
 
 
@@ -74,20 +111,27 @@ template<> struct MatchingType<bool> {
                                       opp::node _parent)
     {return _parent.create_bool(_name);}
 
-    static bool is_valid(opp::value v){ return v.is_bool(); }
+    static bool is_valid(const opp::value& v){ return v.is_bool(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
       return v.to_bool();
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return bool(f);
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return a == b ? 0. : std::numeric_limits<double>::infinity();
+    }
 };
 
 
+// Sent as a float, which is what the clients expect, at the cost of the precision:
+// use Parameter<double, LosslessDouble> when the full double is needed
 template<> struct MatchingType<double> {
     using ofx_type = double;
     using ossia_type = float;
@@ -95,17 +139,96 @@ template<> struct MatchingType<double> {
     static opp::node create_parameter(const std::string& _name, opp::node _parent)
     {return _parent.create_float(_name);}
 
-    static bool is_valid(opp::value v){ return v.is_float(); }
+    static bool is_valid(const opp::value& v){ return v.is_float(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
       return double(v.to_float());
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return float(f);
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::abs(a - b);
+    }
+};
+
+
+/*
+ * Opt-in lossless encoding of doubles (timecodes, geographic coordinates...)
+ * The C++98 API has no double value: the number travels as a decimal string
+ * with 17 significant digits, which reads back exactly
+ * The text does not depend on the locale of the process ("0.5" even where the decimal
+ * separator is a comma): std::to_chars/from_chars when available, streams imbued
+ * with the classic locale otherwise
+ * Plain floats sent by the clients are accepted as well
+ * The node is a string: it has no domain (see AdvertisesDomain)
+ */
+struct LosslessDouble {
+    using ofx_type = double;
+    using ossia_type = std::string;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_string(name);}
+
+    // A string is only valid when it holds a number
+    static bool is_valid(const opp::value& v)
+    {
+      double res;
+      return v.is_float() || (v.is_string() && parse(v.to_string(), res));
+    }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      if(v.is_float())
+        return double(v.to_float());
+      double res = 0.;
+      parse(v.to_string(), res);
+      return res;
+    }
+
+    // Returns false, leaving out untouched, unless the whole string is a number
+    static bool parse(const std::string& str, double& out)
+    {
+      double res;
+#if defined(__cpp_lib_to_chars)
+      const char* end = str.data() + str.size();
+      const auto parsed = std::from_chars(str.data(), end, res);
+      if(parsed.ec != std::errc{} || parsed.ptr != end)
+        return false;
+#else
+      std::istringstream in(str);
+      in.imbue(std::locale::classic());
+      in >> res;
+      if(in.fail() || in.peek() != std::istringstream::traits_type::eof())
+        return false;
+#endif
+      out = res;
+      return true;
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+#if defined(__cpp_lib_to_chars)
+      char str[32];
+      const auto res = std::to_chars(str, str + sizeof(str), f, std::chars_format::general, 17);
+      return ossia_type(str, res.ec == std::errc{} ? res.ptr : str);
+#else
+      std::ostringstream out;
+      out.imbue(std::locale::classic());
+      out << std::setprecision(17) << f;
+      return out.str();
+#endif
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::abs(a - b);
+    }
 };
 
 
@@ -116,17 +239,23 @@ template<> struct MatchingType<ofVec2f> {
     static opp::node create_parameter(const std::string& name, opp::node parent)
     {return parent.create_vec2f(name);}
 
-    static bool is_valid(opp::value v){ return v.is_vec2f(); }
+    static bool is_valid(const opp::value& v){ return v.is_vec2f(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
-      return ofx_type(v.to_vec2f()[0], v.to_vec2f()[1]);
+      const auto a = v.to_vec2f();
+      return ofx_type(a.data[0], a.data[1]);
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return ossia_type{f.x, f.y};
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max(std::abs(a.x - b.x), std::abs(a.y - b.y));
+    }
 };
 
 template<> struct MatchingType<ofVec3f> {
@@ -136,17 +265,23 @@ template<> struct MatchingType<ofVec3f> {
     static opp::node create_parameter(const std::string& name, opp::node parent)
     {return parent.create_vec3f(name);}
 
-    static bool is_valid(opp::value v){ return v.is_vec3f(); }
+    static bool is_valid(const opp::value& v){ return v.is_vec3f(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
-      return ofx_type(v.to_vec3f()[0], v.to_vec3f()[1], v.to_vec3f()[2]);
+      const auto a = v.to_vec3f();
+      return ofx_type(a.data[0], a.data[1], a.data[2]);
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return ossia_type{f.x, f.y, f.z};
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z)});
+    }
 };
 
 template<> struct MatchingType<ofVec4f> {
@@ -156,17 +291,101 @@ template<> struct MatchingType<ofVec4f> {
     static opp::node create_parameter(const std::string& name, opp::node parent)
     {return parent.create_vec4f(name);}
 
-    static bool is_valid(opp::value v){ return v.is_vec4f(); }
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[0], a.data[1], a.data[2], a.data[3]);
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      return ossia_type{f.x, f.y, f.z, f.w};
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z), std::abs(a.w - b.w)});
+    }
+};
+
+template<> struct MatchingType<glm::vec2> {
+    using ofx_type = glm::vec2;
+    using ossia_type = opp::value::vec2f;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_vec2f(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_vec2f(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const auto a = v.to_vec2f();
+      return ofx_type(a.data[0], a.data[1]);
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      return ossia_type{f.x, f.y};
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max(std::abs(a.x - b.x), std::abs(a.y - b.y));
+    }
+};
+
+template<> struct MatchingType<glm::vec3> {
+    using ofx_type = glm::vec3;
+    using ossia_type = opp::value::vec3f;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_vec3f(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_vec3f(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const auto a = v.to_vec3f();
+      return ofx_type(a.data[0], a.data[1], a.data[2]);
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      return ossia_type{f.x, f.y, f.z};
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z)});
+    }
+};
+
+template<> struct MatchingType<glm::vec4> {
+    using ofx_type = glm::vec4;
+    using ossia_type = opp::value::vec4f;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_vec4f(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
-      return ofx_type(v.to_vec4f()[0], v.to_vec4f()[1], v.to_vec4f()[2], v.to_vec4f()[3]);
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[0], a.data[1], a.data[2], a.data[3]);
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return ossia_type{f.x, f.y, f.z, f.w};
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z), std::abs(a.w - b.w)});
+    }
 };
 
 template<> struct MatchingType<ofColor> {
@@ -176,17 +395,23 @@ template<> struct MatchingType<ofColor> {
     static opp::node create_parameter(const std::string& name, opp::node parent)
     {return parent.create_rgba(name);}
 
-    static bool is_valid(opp::value v){ return v.is_vec4f(); }
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
-      return ofx_type(v.to_vec4f()[0]*255., v.to_vec4f()[1]*255., v.to_vec4f()[2]*255., v.to_vec4f()[3]*255.);
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[0]*255., a.data[1]*255., a.data[2]*255., a.data[3]*255.);
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return ossia_type{float(f.r / 255.), float(f.g / 255.), float(f.b / 255.), float(f.a / 255.)};
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b), std::abs(a.a - b.a)});
+    }
 };
 
 template<> struct MatchingType<ofFloatColor> {
@@ -196,39 +421,558 @@ template<> struct MatchingType<ofFloatColor> {
     static opp::node create_parameter(const std::string& name, opp::node parent)
     {return parent.create_argb8(name);}
 
-    static bool is_valid(opp::value v){ return v.is_vec4f(); }
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
 
-    // For those conversions, as there is no rgba8 type in ossia, we swap the 1st and 4th values
+    // For those conversions, as there is no rgba8 type in ossia, we use argb (alpha first)
     static ofx_type convertFromOssia(const opp::value& v)
     {
-      return ofx_type(v.to_vec4f()[0], v.to_vec4f()[1], v.to_vec4f()[2], v.to_vec4f()[3]);
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[1], a.data[2], a.data[3], a.data[0]);
     }
 
-    static ossia_type convert(ofx_type f)
+    static ossia_type convert(const ofx_type& f)
     {
       return ossia_type{f.a, f.r, f.g, f.b};
     }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b), std::abs(a.a - b.a)});
+    }
+};
+
+
+// Orientations: quaternion unit of ossia, real part first (w, x, y, z)
+template<> struct MatchingType<ofQuaternion> {
+    using ofx_type = ofQuaternion;
+    using ossia_type = opp::value::vec4f;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_quaternion(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[1], a.data[2], a.data[3], a.data[0]);
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      const ofVec4f& q = f.asVec4();
+      return ossia_type{q.w, q.x, q.y, q.z};
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      const ofVec4f& p = a.asVec4();
+      const ofVec4f& q = b.asVec4();
+      return std::max({std::abs(p.x - q.x), std::abs(p.y - q.y), std::abs(p.z - q.z), std::abs(p.w - q.w)});
+    }
+};
+
+template<> struct MatchingType<glm::quat> {
+    using ofx_type = glm::quat;
+    using ossia_type = opp::value::vec4f;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_quaternion(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
+
+    // glm::quat takes w first as well
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[0], a.data[1], a.data[2], a.data[3]);
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      return ossia_type{f.w, f.x, f.y, f.z};
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z), std::abs(a.w - b.w)});
+    }
+};
+
+
+// x, y, width, height
+template<> struct MatchingType<ofRectangle> {
+    using ofx_type = ofRectangle;
+    using ossia_type = opp::value::vec4f;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_vec4f(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_vec4f(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const auto a = v.to_vec4f();
+      return ofx_type(a.data[0], a.data[1], a.data[2], a.data[3]);
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      return ossia_type{f.x, f.y, f.width, f.height};
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.width - b.width), std::abs(a.height - b.height)});
+    }
 };
 
 
 template<> struct MatchingType<std::string> {
-    using ofx_type = string;
-    using ossia_type = string;
+    using ofx_type = std::string;
+    using ossia_type = std::string;
 
     static opp::node create_parameter(const std::string& name,
                                       opp::node parent)
     {return parent.create_string(name);}
 
-    static bool is_valid(opp::value v){ return v.is_string(); }
+    static bool is_valid(const opp::value& v){ return v.is_string(); }
 
     static ofx_type convertFromOssia(const opp::value& v)
     {
       return v.to_string();
     }
 
-    static ossia_type convert(ofx_type f)
+    static const ossia_type& convert(const ofx_type& f)
+    {
+      return f;
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      return a == b ? 0. : std::numeric_limits<double>::infinity();
+    }
+};
+
+
+/*
+ * Numeric arrays are sent as one list value
+ * The C++98 API only knows lists of opp::value, so the elements are boxed,
+ * but in a single pass with a single allocation each way
+ */
+template<typename Element>
+struct ListMatchingType {
+    using ofx_type = std::vector<Element>;
+    using ossia_type = std::vector<opp::value>;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_list(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_list(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const ossia_type list = v.to_list();
+      ofx_type res;
+      res.reserve(list.size());
+      for(const opp::value& element : list)
+        res.push_back(toElement(element, static_cast<Element*>(nullptr)));
+      return res;
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      ossia_type res;
+      res.reserve(f.size());
+      for(Element element : f)
+        res.emplace_back(element);
+      return res;
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      if(a.size() != b.size())
+        return std::numeric_limits<double>::infinity();
+
+      double res = 0.;
+      for(std::size_t i = 0; i < a.size(); i++)
+        res = std::max(res, std::abs(double(a[i]) - double(b[i])));
+      return res;
+    }
+
+private:
+    static float toElement(const opp::value& v, float*){ return v.to_float(); }
+    static int toElement(const opp::value& v, int*){ return v.to_int(); }
+};
+
+template<> struct MatchingType<std::vector<float>> : ListMatchingType<float> { };
+
+template<> struct MatchingType<std::vector<int>> : ListMatchingType<int> { };
+
+
+/*
+ * 4x4 matrices are sent as a list of 16 floats, in the OpenGL memory order
+ * shared by ofMatrix4x4 and glm::mat4, read and written straight from their storage
+ * Missing elements of a shorter list are taken from the identity
+ */
+template<typename Matrix>
+struct MatrixMatchingType {
+    using ofx_type = Matrix;
+    using ossia_type = std::vector<opp::value>;
+
+    static constexpr std::size_t size = 16;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_list(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_list(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const ossia_type list = v.to_list();
+      ofx_type res = identity(static_cast<Matrix*>(nullptr));
+      float* data = ptr(res);
+      const std::size_t n = list.size() < size ? list.size() : size;
+      for(std::size_t i = 0; i < n; i++)
+        data[i] = list[i].to_float();
+      return res;
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      const float* data = ptr(f);
+      ossia_type res;
+      res.reserve(size);
+      for(std::size_t i = 0; i < size; i++)
+        res.emplace_back(data[i]);
+      return res;
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b)
+    {
+      const float* p = ptr(a);
+      const float* q = ptr(b);
+      double res = 0.;
+      for(std::size_t i = 0; i < size; i++)
+        res = std::max(res, std::abs(double(p[i]) - double(q[i])));
+      return res;
+    }
+
+private:
+    static ofMatrix4x4 identity(ofMatrix4x4*){ return ofMatrix4x4{}; }
+    static glm::mat4 identity(glm::mat4*){ return glm::mat4(1.f); }
+
+    static float* ptr(ofMatrix4x4& m){ return m.getPtr(); }
+    static const float* ptr(const ofMatrix4x4& m){ return m.getPtr(); }
+    static float* ptr(glm::mat4& m){ return glm::value_ptr(m); }
+    static const float* ptr(const glm::mat4& m){ return glm::value_ptr(m); }
+};
+
+template<> struct MatchingType<ofMatrix4x4> : MatrixMatchingType<ofMatrix4x4> { };
+
+template<> struct MatchingType<glm::mat4> : MatrixMatchingType<glm::mat4> { };
+
+
+/*
+ * Binary payloads (previews, LUTs...) are sent as buffer nodes
+ * The C++98 API carries them in a string value: one copy each way,
+ * without any intermediate encoding
+ */
+template<> struct MatchingType<ofBuffer> {
+    using ofx_type = ofBuffer;
+    using ossia_type = std::string;
+
+    static opp::node create_parameter(const std::string& name, opp::node parent)
+    {return parent.create_buffer(name);}
+
+    static bool is_valid(const opp::value& v){ return v.is_string(); }
+
+    static ofx_type convertFromOssia(const opp::value& v)
+    {
+      const std::string data = v.to_string();
+      return ofx_type(data.data(), data.size());
+    }
+
+    static ossia_type convert(const ofx_type& f)
+    {
+      return ossia_type(f.getData(), f.size());
+    }
+
+    static double distance(const ofx_type& a, const ofx_type& b);
+};
+
+
+/*
+ * Comparison of a value with the last one published or received
+ * Overloaded for the ofx types without operator==
+ */
+template<typename T>
+inline bool equals(const T& a, const T& b)
+{
+  return a == b;
+}
+
+inline bool equals(const ofBuffer& a, const ofBuffer& b)
+{
+  return a.size() == b.size()
+      && (a.size() == 0 || std::memcmp(a.getData(), b.getData(), a.size()) == 0);
+}
+
+inline double MatchingType<ofBuffer>::distance(const ofx_type& a, const ofx_type& b)
+{
+  return equals(a, b) ? 0. : std::numeric_limits<double>::infinity();
+}
+
+/*
+ * Whether the min and max of a parameter are set on its node
+ */
+template<typename Traits> struct AdvertisesDomain : std::true_type { };
+
+// a domain would be advertised as two strings
+template<> struct AdvertisesDomain<LosslessDouble> : std::false_type { };
+
+/*
+ * value_step_size attribute of a node for a min delta of Traits::distance() units,
+ * in the units of the node value (0: no step size to advertise)
+ */
+template<typename Traits> struct StepSize {
+    static double of(double delta) { return delta; }
+};
+
+// 0-255 components sent as 0-1 floats
+template<> struct StepSize<MatchingType<ofColor>> {
+    static double of(double delta) { return delta / 255.; }
+};
+
+// no numeric value on the node
+template<> struct StepSize<LosslessDouble> {
+    static double of(double) { return 0.; }
+};
+template<> struct StepSize<MatchingType<std::string>> {
+    static double of(double) { return 0.; }
+};
+template<> struct StepSize<MatchingType<ofBuffer>> {
+    static double of(double) { return 0.; }
+};
+
+/*
+ * Lenient conversions, for controllers sending a close but different type
+ * (an int to a float parameter, a float to a toggle, an rgb color, a list of numbers...)
+ * Wire<T> reads one type of opp::value, Coerce<ofx type, T> turns it into the ofx type
+ * and Lenient<Traits> lists the wire types accepted after the exact one, in order.
+ * Everything is resolved at compile time for each Parameter<T>:
+ * a value of the exact type costs one type check and one load
+ */
+template<typename T> struct Wire;
+
+template<> struct Wire<int> {
+    static bool is(const opp::value& v){ return v.is_int(); }
+    static int get(const opp::value& v){ return v.to_int(); }
+};
+
+template<> struct Wire<float> {
+    static bool is(const opp::value& v){ return v.is_float(); }
+    static float get(const opp::value& v){ return v.to_float(); }
+};
+
+template<> struct Wire<bool> {
+    static bool is(const opp::value& v){ return v.is_bool(); }
+    static bool get(const opp::value& v){ return v.to_bool(); }
+};
+
+template<> struct Wire<opp::value::vec2f> {
+    static bool is(const opp::value& v){ return v.is_vec2f(); }
+    static opp::value::vec2f get(const opp::value& v){ return v.to_vec2f(); }
+};
+
+template<> struct Wire<opp::value::vec3f> {
+    static bool is(const opp::value& v){ return v.is_vec3f(); }
+    static opp::value::vec3f get(const opp::value& v){ return v.to_vec3f(); }
+};
+
+template<> struct Wire<opp::value::vec4f> {
+    static bool is(const opp::value& v){ return v.is_vec4f(); }
+    static opp::value::vec4f get(const opp::value& v){ return v.to_vec4f(); }
+};
+
+template<> struct Wire<std::vector<opp::value>> {
+    static bool is(const opp::value& v){ return v.is_list(); }
+    static std::vector<opp::value> get(const opp::value& v){ return v.to_list(); }
+};
+
+template<typename... T> struct WireTypes { };
+
+// No lenient conversion by default
+template<typename Traits> struct Lenient { using types = WireTypes<>; };
+
+template<> struct Lenient<MatchingType<float>> { using types = WireTypes<int, bool>; };
+template<> struct Lenient<MatchingType<double>> { using types = WireTypes<int, bool>; };
+template<> struct Lenient<MatchingType<int>> { using types = WireTypes<float, bool>; };
+template<> struct Lenient<MatchingType<bool>> { using types = WireTypes<float, int>; };
+template<> struct Lenient<MatchingType<ofVec2f>> { using types = WireTypes<std::vector<opp::value>>; };
+template<> struct Lenient<MatchingType<ofVec3f>> { using types = WireTypes<std::vector<opp::value>>; };
+template<> struct Lenient<MatchingType<ofVec4f>> { using types = WireTypes<std::vector<opp::value>>; };
+template<> struct Lenient<MatchingType<glm::vec2>> { using types = WireTypes<std::vector<opp::value>>; };
+template<> struct Lenient<MatchingType<glm::vec3>> { using types = WireTypes<std::vector<opp::value>>; };
+template<> struct Lenient<MatchingType<glm::vec4>> { using types = WireTypes<std::vector<opp::value>>; };
+template<> struct Lenient<MatchingType<ofColor>> { using types = WireTypes<opp::value::vec3f>; };
+template<> struct Lenient<MatchingType<ofFloatColor>> { using types = WireTypes<opp::value::vec3f>; };
+template<> struct Lenient<MatchingType<std::vector<float>>> {
+    using types = WireTypes<float, int, opp::value::vec2f, opp::value::vec3f, opp::value::vec4f>;
+};
+template<> struct Lenient<MatchingType<std::vector<int>>> { using types = WireTypes<int, float>; };
+
+template<typename To, typename From> struct Coerce;
+
+// Numbers: ints are rounded, a toggle is on from the middle of [0, 1]
+template<typename From> struct Coerce<float, From> {
+    static float apply(From v){ return float(v); }
+};
+
+template<typename From> struct Coerce<double, From> {
+    static double apply(From v){ return double(v); }
+};
+
+template<> struct Coerce<int, float> {
+    static int apply(float v){ return int(std::lround(v)); }
+};
+
+template<> struct Coerce<int, bool> {
+    static int apply(bool v){ return v ? 1 : 0; }
+};
+
+template<> struct Coerce<bool, float> {
+    static bool apply(float v){ return v >= 0.5f; }
+};
+
+template<> struct Coerce<bool, int> {
+    static bool apply(int v){ return v != 0; }
+};
+
+// Vectors from a list of numbers: missing components are 0
+template<std::size_t N>
+std::array<float, N> firstNumbers(const std::vector<opp::value>& list)
+{
+  std::array<float, N> res{};
+  const std::size_t n = list.size() < N ? list.size() : N;
+  for(std::size_t i = 0; i < n; i++)
+  {
+    const opp::value& v = list[i];
+    res[i] = v.is_float() ? v.to_float() : v.is_int() ? float(v.to_int()) : v.is_bool() ? float(v.to_bool()) : 0.f;
+  }
+  return res;
+}
+
+template<typename Vec, std::size_t N>
+struct CoerceVec {
+    static Vec apply(const std::vector<opp::value>& list)
+    {
+      const auto a = firstNumbers<N>(list);
+      return make(a, std::integral_constant<std::size_t, N>{});
+    }
+
+private:
+    static Vec make(const std::array<float, N>& a, std::integral_constant<std::size_t, 2>){ return Vec(a[0], a[1]); }
+    static Vec make(const std::array<float, N>& a, std::integral_constant<std::size_t, 3>){ return Vec(a[0], a[1], a[2]); }
+    static Vec make(const std::array<float, N>& a, std::integral_constant<std::size_t, 4>){ return Vec(a[0], a[1], a[2], a[3]); }
+};
+
+template<> struct Coerce<ofVec2f, std::vector<opp::value>> : CoerceVec<ofVec2f, 2> { };
+template<> struct Coerce<ofVec3f, std::vector<opp::value>> : CoerceVec<ofVec3f, 3> { };
+template<> struct Coerce<ofVec4f, std::vector<opp::value>> : CoerceVec<ofVec4f, 4> { };
+template<> struct Coerce<glm::vec2, std::vector<opp::value>> : CoerceVec<glm::vec2, 2> { };
+template<> struct Coerce<glm::vec3, std::vector<opp::value>> : CoerceVec<glm::vec3, 3> { };
+template<> struct Coerce<glm::vec4, std::vector<opp::value>> : CoerceVec<glm::vec4, 4> { };
+
+// Colors without alpha are opaque
+template<> struct Coerce<ofColor, opp::value::vec3f> {
+    static ofColor apply(const opp::value::vec3f& v)
+    {
+      return ofColor(v.data[0]*255., v.data[1]*255., v.data[2]*255., 255.);
+    }
+};
+
+template<> struct Coerce<ofFloatColor, opp::value::vec3f> {
+    static ofFloatColor apply(const opp::value::vec3f& v)
+    {
+      return ofFloatColor(v.data[0], v.data[1], v.data[2], 1.f);
+    }
+};
+
+// Arrays from a single number or a vector
+template<typename From> struct Coerce<std::vector<float>, From> {
+    static std::vector<float> apply(From v){ return std::vector<float>(1, float(v)); }
+};
+
+template<> struct Coerce<std::vector<float>, opp::value::vec2f> {
+    static std::vector<float> apply(const opp::value::vec2f& v){ return {v.data[0], v.data[1]}; }
+};
+
+template<> struct Coerce<std::vector<float>, opp::value::vec3f> {
+    static std::vector<float> apply(const opp::value::vec3f& v){ return {v.data[0], v.data[1], v.data[2]}; }
+};
+
+template<> struct Coerce<std::vector<float>, opp::value::vec4f> {
+    static std::vector<float> apply(const opp::value::vec4f& v){ return {v.data[0], v.data[1], v.data[2], v.data[3]}; }
+};
+
+template<> struct Coerce<std::vector<int>, int> {
+    static std::vector<int> apply(int v){ return std::vector<int>(1, v); }
+};
+
+template<> struct Coerce<std::vector<int>, float> {
+    static std::vector<int> apply(float v){ return std::vector<int>(1, int(std::lround(v))); }
+};
+
+/*
+ * Reads a value received for a Parameter<ofx_type, Traits>:
+ * the exact type of Traits first, then the lenient conversions
+ * Returns false when the type can't be converted
+ */
+template<typename Traits>
+struct Conversion {
+    using ofx_type = typename Traits::ofx_type;
+
+    static bool read(const opp::value& v, ofx_type& out)
+    {
+      if(Traits::is_valid(v))
+      {
+        out = Traits::convertFromOssia(v);
+        return true;
+      }
+      return readLenient(v, out, typename Lenient<Traits>::types{});
+    }
+
+private:
+    static bool readLenient(const opp::value&, ofx_type&, WireTypes<>)
+    {
+      return false;
+    }
+
+    template<typename T, typename... Rest>
+    static bool readLenient(const opp::value& v, ofx_type& out, WireTypes<T, Rest...>)
+    {
+      if(Wire<T>::is(v))
+      {
+        out = Coerce<ofx_type, T>::apply(Wire<T>::get(v));
+        return true;
+      }
+      return readLenient(v, out, WireTypes<Rest...>{});
+    }
+};
+
+
+// Lossless doubles are parsed once, an unparsable string being a mismatch
+template<>
+struct Conversion<LosslessDouble> {
+    static bool read(const opp::value& v, double& out)
     {
-      return std::string(f);
+      if(v.is_float())
+      {
+        out = double(v.to_float());
+        return true;
+      }
+      return v.is_string() && LosslessDouble::parse(v.to_string(), out);
     }
 };
 
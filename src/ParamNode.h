@@ -2,9 +2,120 @@
 
 #include <ossia-cpp98.hpp>
 #include "OssiaTypes.h"
+#include "DeviceContext.h"
+#include "Stats.h"
+#include "Snapshot.h"
+#include "TrafficRecorder.h"
+#include <types/ofParameter.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <iostream>
 
 namespace ossia { 
 
+// "device:/a/b" -> "/a/b", the root being ""
+inline std::string relativeAddress(const std::string& address)
+{
+  const std::size_t slash = address.find('/');
+  if(slash == std::string::npos || slash + 1 == address.size())
+    return {};
+  return address.substr(slash);
+}
+
+/*
+ * Outbound filtering of a node, see Parameter::setMaxRate(),
+ * Parameter::setMinDelta() and Parameter::setRepetitionFilter()
+ * */
+
+struct PublishFilter {
+  using clock = std::chrono::steady_clock;
+
+  clock::duration minInterval{};
+  clock::time_point lastPublish{};
+  double minDelta{};
+  bool repetitionFilter{false};
+
+  // Would a publication now exceed the max rate ?
+  bool tooSoon() const
+  {
+    return minInterval.count() > 0 && clock::now() - lastPublish < minInterval;
+  }
+
+  void published()
+  {
+    if(minInterval.count() > 0)
+      lastPublish = clock::now();
+  }
+};
+
+/*
+ * Result of ParamNode::readNodeValue()
+ * */
+
+template<typename DataValue>
+struct NodeValue {
+  DataValue value{};
+  bool valid{false};
+
+  explicit operator bool() const { return valid; }
+};
+
+/*
+ * Where the change of a parameter comes from
+ * */
+
+enum class Origin {
+  None,   // no change in progress
+  Local,  // ofParameter::set() (e.g. from the GUI) or Parameter::update()
+  Remote  // value received from the network
+};
+
+class ParamNode;
+
+/*
+ * Tags the changes made by this thread to a node, for its lifetime
+ * Setting a value on a node calls its value callbacks right away, on the same thread:
+ * the callback of a Parameter uses the tag to ignore its own publications
+ * */
+
+class OriginScope {
+public:
+  OriginScope(const ParamNode* node, Origin origin):
+    _previous(current())
+  {
+    current() = {node, origin};
+  }
+
+  OriginScope(const OriginScope&) = delete;
+  OriginScope& operator=(const OriginScope&) = delete;
+
+  ~OriginScope()
+  {
+    current() = _previous;
+  }
+
+  static Origin of(const ParamNode* node)
+  {
+    const Tag& tag = current();
+    return tag.node == node ? tag.origin : Origin::None;
+  }
+
+private:
+  struct Tag {
+    const ParamNode* node;
+    Origin origin;
+  };
+
+  static Tag& current()
+  {
+    static thread_local Tag tag{nullptr, Origin::None};
+    return tag;
+  }
+
+  Tag _previous;
+};
+
 /*
  * Class encapsulating node_base* to avoid segfault
  * */
@@ -13,6 +124,9 @@ class ParamNode {
 public:
   opp::node _parentNode{};
   opp::node _currentNode{};
+  std::shared_ptr<DeviceContext> _context{};
+  Stats _stats;
+  Address _address{}; // relative to the device, set when the parameter is tracked
 
   /**
    * Methods to communicate via OSSIA to score or other OSCquery clients
@@ -29,10 +143,10 @@ public:
     _currentNode = _parentNode.create_child(name);
   }
 
-  template<typename DataValue>
-  void createNode(const std::string& name, DataValue data)
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  void createNode(const std::string& name, const DataValue& data)
   {
-    using ossia_type = MatchingType<DataValue>;
+    using ossia_type = Traits;
 
     // creates node with parameter
     _currentNode = ossia_type::create_parameter(name, _parentNode);
@@ -41,10 +155,11 @@ public:
   }
 
   // Creates the node setting domain
-  template<typename DataValue>
-  void createNode(const std::string& name, DataValue data, DataValue min, DataValue max)
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  void createNode(const std::string& name, const DataValue& data,
+                  const DataValue& min, const DataValue& max)
   {
-    using ossia_type = MatchingType<DataValue>;
+    using ossia_type = Traits;
 
     /// creates node with parameter
     _currentNode = ossia_type::create_parameter(name, _parentNode);
@@ -52,92 +167,204 @@ public:
     _currentNode.set_value(ossia_type::convert(data));
 
     //sets domain
-    _currentNode.set_min(ossia_type::convert(min));
-    _currentNode.set_max(ossia_type::convert(max));
+    if(AdvertisesDomain<Traits>::value)
+    {
+      _currentNode.set_min(ossia_type::convert(min));
+      _currentNode.set_max(ossia_type::convert(max));
+    }
   }
 
   // Publishes value to the node
-  template<typename DataValue>
-  void publishValue(DataValue other)
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  void publishValue(const DataValue& other)
   {
-    using ossia_type = MatchingType<DataValue>;
-    _currentNode.set_value(ossia_type::convert(other));
+    using ossia_type = Traits;
+    {
+      // a change without origin is a local one
+      const Origin origin = OriginScope::of(this);
+      OriginScope scope{this, origin == Origin::None ? Origin::Local : origin};
+      _currentNode.set_value(ossia_type::convert(other));
+    }
+
+    Stats::count(_stats.published);
+    if(_context)
+      Stats::count(_context->stats.published);
   }
 
-  // Pulls the node value
-  template<typename DataValue>
-  DataValue pullNodeValue()
+  // A value of the wrong type was received or read
+  void countMismatch()
   {
-    using ossia_type = MatchingType<DataValue>;
+    Stats::count(_stats.mismatches);
+    if(_context)
+      Stats::count(_context->stats.mismatches);
+  }
 
+  // Reads the node value, errors of libossia and of the conversion are logged, not thrown
+  // valid is false when the node has no parameter, a value of another type or could not be read
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  NodeValue<DataValue> readNodeValue()
+  {
+    NodeValue<DataValue> res;
     try
     {
-      auto val = _currentNode.get_value();
-      if(ossia_type::is_valid(val))
-        return ossia_type::convertFromOssia(val);
-      else
-        std::cerr <<  "error [ofxOssia::pullNodeValue()] : of and ossia types do not match \n" ; // Was:
-                   // <<(int) val.getType()  << " " << (int) ossia_type::val << "\n" ; // Can we still do that with safeC++ ??
-      return {};
+      if(!_currentNode || !_currentNode.has_parameter())
+        return res;
+
+      res.valid = Conversion<Traits>::read(_currentNode.get_value(), res.value);
+      if(!res.valid)
+      {
+        countMismatch();
+        std::cerr <<  "error [ofxOssia::readNodeValue()] : of and ossia types do not match \n" ;
+      }
     }
     catch(std::exception& e)
     {
-      std::cerr <<  "error [ofxOssia::pullNodeValue()] : " << e.what() << "\n" ;
-      return {};
-
+      res = NodeValue<DataValue>{};
+      std::cerr <<  "error [ofxOssia::readNodeValue()] : " << e.what() << "\n" ;
     }
-
     catch(...)
     {
-      auto val = _currentNode.get_value();
-      std::cerr <<  "error [ofxOssia::pullNodeValue()] : : of and ossia types do not match \n" ; // Was:
-                 // << ossia::value_to_pretty_string(val)  << " " << (int) ossia_type::val << "\n" ; // Can we still do that with safeC++ ??
-      return {};
+      res = NodeValue<DataValue>{};
+      std::cerr <<  "error [ofxOssia::readNodeValue()] : of and ossia types do not match \n" ;
     }
+    return res;
   }
 
+  // Pulls the node value (default value if it can't be read)
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  DataValue pullNodeValue()
+  {
+    return readNodeValue<DataValue, Traits>().value;
+  }
 
-  // Pulls the node value
-  template<typename DataValue>
-  DataValue cloneNodeValue()
+  ParamNode () = default;
+
+  ~ParamNode ()
   {
-    using ossia_type = MatchingType<DataValue>;
+    if(_context)
+      if(TrafficRecorder* recorder = _context->recorder.load(std::memory_order_acquire))
+        recorder->forget(this);
 
-    try
+    if (_currentNode && _parentNode)
     {
-      auto val = _currentNode.get_value();
-      if(ossia_type::is_valid(val))
-        return ossia_type::convertFromOssia(val);
-      else
-          std::cerr <<  "error [ofxOssia::cloneNodeValue()] : of and ossia types do not match\n" ; // Was:
-                     // <<(int) val.getType()  << " " << (int) ossia_type::val << "\n" ; // Can we still do that with safeC++ ??
-        return {};
+      _currentNode.remove_children();
+      _parentNode.remove_child(_currentNode.get_name());
     }
-    catch(std::exception& e)
-    {
-      std::cerr <<  "error [ofxOssia::cloneNodeValue()] : " << e.what() << "\n" ;
-      return {};
+  }
+};
 
-    }
+/*
+ * ParamNode of a Parameter<DataValue, Traits>
+ * Keeps a copy of the last value published or received, so that a local change
+ * can be compared to it without reading back and converting the node value
+ * In the Immediate inbound mode remote values are received on the network threads:
+ * the copy is only accessed under its lock
+ * */
 
-    catch(...)
+template<typename DataValue, typename Traits = MatchingType<DataValue>>
+class TypedParamNode : public ParamNode {
+public:
+  PublishFilter _filter{};
+
+  void createNode(const std::string& name, const DataValue& data)
+  {
+    ParamNode::createNode<DataValue, Traits>(name, data);
+    setShadow(data);
+  }
+
+  void createNode(const std::string& name, const DataValue& data,
+                  const DataValue& min, const DataValue& max)
+  {
+    ParamNode::createNode<DataValue, Traits>(name, data, min, max);
+    setShadow(data);
+  }
+
+  // Publishes value to the node
+  void publishValue(const DataValue& other)
+  {
+    ParamNode::publishValue<DataValue, Traits>(other);
+    setShadow(other);
+    _filter.published();
+  }
+
+  // Is this change worth publishing according to the filter ?
+  bool passesFilter(const DataValue& data) const
+  {
+    if(!_filter.repetitionFilter && _filter.minDelta <= 0.)
+      return true;
+
+    std::lock_guard<std::mutex> lock(_shadowMutex);
+    if(_filter.repetitionFilter && equals(_shadow, data))
+      return false;
+    if(_filter.minDelta > 0. && Traits::distance(data, _shadow) < _filter.minDelta)
+      return false;
+    return true;
+  }
+
+  // A value was received from the node (any thread)
+  void receivedValue(const DataValue& other)
+  {
+    setShadow(other);
+  }
+
+  // Is this value the last one published or received ?
+  bool isPublished(const DataValue& data) const
+  {
+    std::lock_guard<std::mutex> lock(_shadowMutex);
+    return equals(_shadow, data);
+  }
+
+  // Registers the ofParameter in the snapshots (see ofxOssia::saveSnapshot())
+  // and in the address index of the device (see ofxOssia::find())
+  // The copy shares its value: loading a snapshot goes through the listeners of the Parameter
+  void track(const ofParameter<DataValue>& parameter)
+  {
+    _parameter.reset(new ofParameter<DataValue>(parameter));
+    if(_context)
     {
-      auto val = _currentNode.get_value();
-      std::cerr <<  "error [ofxOssia::cloneNodeValue()] : : of and ossia types do not match \n" ; // Was:
-                 // << ossia::value_to_pretty_string(val)  << " " << (int) ossia_type::val << "\n" ; // Can we still do that with safeC++ ??
-      return {};
+      _context->snapshotEntries[this] = {&TypedParamNode::saveValue, &TypedParamNode::loadValue,
+                                         snapshot::typeId<DataValue, Traits>()};
+      _address = Address{relativeAddress(_currentNode.get_address())};
+      _context->index.insert(_address, {this, &typeid(DataValue), _parameter.get()});
     }
   }
 
-  ParamNode () = default;
+  TypedParamNode() = default;
 
-  ~ParamNode ()
+  ~TypedParamNode()
   {
-    if (_currentNode && _parentNode)
+    if(_context && _parameter)
     {
-      _currentNode.remove_children();
-      _parentNode.remove_child(_currentNode.get_name());
+      _context->snapshotEntries.erase(this);
+      _context->index.erase(_address, this);
     }
   }
+
+private:
+  std::unique_ptr<ofParameter<DataValue>> _parameter;
+  DataValue _shadow{};
+  mutable std::mutex _shadowMutex;
+
+  void setShadow(const DataValue& value)
+  {
+    std::lock_guard<std::mutex> lock(_shadowMutex);
+    _shadow = value;
+  }
+
+  static void saveValue(const ParamNode* node, std::string& out)
+  {
+    auto self = static_cast<const TypedParamNode*>(node);
+    SnapshotValue<DataValue, Traits>::write(self->_parameter->get(), out);
+  }
+
+  static bool loadValue(ParamNode* node, const char* data, std::size_t size)
+  {
+    auto self = static_cast<TypedParamNode*>(node);
+    DataValue value{};
+    if(!SnapshotValue<DataValue, Traits>::read(data, size, value))
+      return false;
+    self->_parameter->set(value);
+    return true;
+  }
 };
 } // namespace ossia 
@@ -1,8 +1,12 @@
 #pragma once
 #include "ParamNode.h"
 #include "ParameterGroup.h"
+#include "CoalescingSlot.h"
+#include "SlotTable.h"
 #include <ossia-cpp98.hpp>
 #include <types/ofParameter.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 namespace ossia
@@ -12,120 +16,333 @@ namespace ossia
  * Class inheriting from ofParameter
  * Listeners (listening to OSCquery client(s) and GUI) are enabled
  * By passing a std::type in argument, the OSSIA type is deduced in the class
+ * Traits can replace the default conversion of the type, e.g. Parameter<double, LosslessDouble>
  **/
 
-template <class DataValue>
+template <class DataValue, class Traits = MatchingType<DataValue>>
 class Parameter : public ofParameter<DataValue>
 {
 private:
-  std::shared_ptr<ParamNode> _impl{};
-  opp::callback_index _callbackIt;
+  using ossia_type = Traits;
 
-  using ossia_type = MatchingType<DataValue>;
-
-  // Listener for the GUI (but called also when OSCquery client(s) send value)
-  void listen(DataValue &data)
+  /*
+   * What the GUI listener, the remote callback and the device queues work on
+   * It stays on the heap: moving a Parameter only moves the pointer,
+   * the registrations in libossia and in the ofParameter remain valid
+   * The callback and the queues reach it through a handle of the SlotTable,
+   * which resolves to nullptr once the binding is cleaned up
+   **/
+  struct Binding
   {
-    // check if the value to be published is not already published
-    if(_impl->cloneNodeValue<DataValue>() != data)
-    { // i-score->GUI OK
-      _impl->publishValue(data);
+    ofParameter<DataValue> _parameter; // shares the value of the Parameter
+    std::shared_ptr<TypedParamNode<DataValue, Traits>> _impl{};
+    opp::callback_index _callbackIt;
+    std::unique_ptr<CoalescingSlot<DataValue>> _coalescing{};
+    std::atomic<bool> _coalesce{false};
+    bool _dirty{false};
+    SlotTable::Handle _handle{0};
+
+    explicit Binding(const ofParameter<DataValue>& parameter):
+      _parameter(parameter)
+    {
     }
-  }
 
-  // listen to of update (GUI)
-  void enableLocalUpdate()
-  {
-    this->addListener(this, &Parameter::listen);
-  }
+    ~Binding()
+    {
+      SlotTable::instance().release(_handle);
+    }
 
-  void cleanup()
-  {
-    if(_impl->_currentNode)
+    // Acquired on first use, released by cleanup()
+    void* context()
+    {
+      if(!_handle)
+        _handle = SlotTable::instance().acquire(this);
+      return SlotTable::toContext(_handle);
+    }
+
+    static Binding* resolve(void* context)
+    {
+      return static_cast<Binding*>(SlotTable::instance().resolve(SlotTable::fromContext(context)));
+    }
+
+    void setCoalesced(bool coalesce)
+    {
+      if(coalesce && !_coalescing)
+        _coalescing.reset(new CoalescingSlot<DataValue>);
+      _coalesce.store(coalesce, std::memory_order_release);
+    }
+
+    // Listener for the GUI (but called also when OSCquery client(s) send value)
+    // Remote values and update() reach it already published: the comparison only lets through
+    // a different value set meanwhile by another listener (e.g. clamping)
+    void listen(DataValue &data)
     {
-      this->removeListener(this, &Parameter::listen);
-      if(_impl->_currentNode.has_parameter()  && _callbackIt)
+      // check if the value to be published is not already published
+      if(!_impl->isPublished(data))
+      { // i-score->GUI OK
+        publish(data);
+      }
+    }
+
+    // Publishes now, or at the next ofxOssia::flush() when the device is batching
+    // or when publishing now would exceed the max rate
+    void publish(const DataValue& data)
+    {
+      if(!_impl->passesFilter(data))
+        return;
+
+      const auto& device = _impl->_context;
+      if(device && (device->batching || _impl->_filter.tooSoon()))
       {
-        _impl->_currentNode.remove_value_callback(_callbackIt);
+        if(!_dirty)
+        {
+          _dirty = true;
+          device->markDirty(context(), &Binding::publishDirty);
+        }
+      }
+      else
+      {
+        _impl->publishValue(data);
       }
     }
-  }
 
-  // Add remote (e.g. score) callback
-  void enableRemoteUpdate()
-  {
-    if(_impl->_currentNode.has_parameter())
+    static bool publishDirty(void* context)
+    {
+      Binding* self = resolve(context);
+      if(!self)
+        return true; // cleaned up since
+      if(self->_impl->_filter.tooSoon())
+        return false;
+
+      self->_dirty = false;
+      // the value may have come back to the published one in the meantime
+      const DataValue& data = self->_parameter.get();
+      if(!self->_impl->isPublished(data) && self->_impl->passesFilter(data))
+        self->_impl->publishValue(data);
+      return true;
+    }
+
+    // listen to of update (GUI)
+    void enableLocalUpdate()
+    {
+      _parameter.addListener(this, &Binding::listen);
+    }
+
+    void cleanup()
+    {
+      // the node may already be gone with its branch (ParameterGroup::teardown()),
+      // the listener has to be removed anyway
+      _parameter.removeListener(this, &Binding::listen);
+      if(_impl->_currentNode)
+      {
+        if(_impl->_currentNode.has_parameter()  && _callbackIt)
+        {
+          _impl->_currentNode.remove_value_callback(_callbackIt);
+        }
+      }
+      _callbackIt = opp::callback_index{};
+      // values queued and changes waiting for a flush with the old handle are now ignored
+      SlotTable::instance().release(_handle);
+      _handle = 0;
+      if(_coalescing)
+        _coalescing->unschedule();
+      _dirty = false;
+    }
+
+    // Applies a value received from a remote
+    void applyRemote(DataValue& data)
+    {
+      _impl->receivedValue(data);
+      if(!equals(data, _parameter.get()))
+      {
+        OriginScope scope{_impl.get(), Origin::Remote};
+        _parameter.set(data);
+      }
+    }
+
+    // Applies a value of the device queue
+    static void applyQueued(void* context, DataValue& data)
+    {
+      if(Binding* self = resolve(context))
+        self->applyRemote(data);
+    }
+
+    // Applies the latest value of the coalescing slot
+    static void applyCoalesced(void* context)
+    {
+      Binding* self = resolve(context);
+      if(!self)
+        return;
+      if(DataValue* data = self->_coalescing->take())
+      {
+        self->applyRemote(*data);
+      }
+    }
+
+    // Converts a value received from a remote and applies or queues it
+    static void receive(Binding* self, const opp::value& val)
+    {
+        // exact type, or one of the lenient conversions of the type (see OssiaTypes.h)
+        DataValue data{};
+        if(Conversion<ossia_type>::read(val, data))
+        {
+            const auto& device = self->_impl->_context;
+            Stats::count(self->_impl->_stats.received);
+            if(device)
+                Stats::count(device->stats.received);
+
+            if(device && self->_coalesce.load(std::memory_order_acquire))
+            {
+                // only the latest value is kept, the slot is scheduled once per drain
+                if(self->_coalescing->store(std::move(data))
+                   && !device->inbound.template push<&Binding::applyCoalesced>(SlotTable::toContext(self->_handle)))
+                {
+                    self->_coalescing->unschedule();
+                }
+            }
+            else if(device && device->queueInbound())
+            {
+                // applied later on the main thread, by ofxOssia::drainInbound()
+                device->inbound.template push<DataValue, &Binding::applyQueued>(SlotTable::toContext(self->_handle), std::move(data));
+            }
+            else
+            {
+                self->applyRemote(data);
+            }
+        }
+        else
+        {
+            self->_impl->countMismatch();
+            std::cerr << "error [ofxOssia::enableRemoteUpdate()] : of and ossia types do not match \n" ;
+            // Was: "<< (int) val.getType()  << " " << (int) ossia_type::val << "\n" ;
+            return;
+        }
+    }
+
+    // Add remote (e.g. score) callback
+    void enableRemoteUpdate()
     {
-      _callbackIt = _impl->_currentNode.set_value_callback([](void* context, const opp::value& val)
+      if(_impl->_currentNode.has_parameter())
       {
-          Parameter* self = reinterpret_cast<Parameter*>(context);
-          //using value_type = const typename ossia_type::ossia_type;
-          if(ossia_type::is_valid(val))
-          {
-              DataValue data = ossia_type::convertFromOssia(val);
-              if(data != self->get())
-              {
-                  self->set(data);
-              }
-          }
-          else
-          {
-              std::cerr << "error [ofxOssia::enableRemoteUpdate()] : of and ossia types do not match \n" ;
-              // Was: "<< (int) val.getType()  << " " << (int) ossia_type::val << "\n" ;
+        _callbackIt = _impl->_currentNode.set_value_callback([](void* context, const opp::value& val)
+        {
+            Binding* self = resolve(context);
+            if(!self)
+              return;
+            // our own publication (see ParamNode::publishValue()): nothing to receive
+            if(OriginScope::of(self->_impl.get()) != Origin::None)
               return;
-          }
-      },  this);
+
+            const auto& device = self->_impl->_context;
+            if(device)
+              if(TrafficRecorder* recorder = device->recorder.load(std::memory_order_acquire))
+                recorder->record(self->_impl.get(), val);
+
+            if(device && device->timeCallbacks.load(std::memory_order_relaxed))
+            {
+                const auto start = std::chrono::steady_clock::now();
+                receive(self, val);
+                const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - start).count();
+                self->_impl->_stats.callbackNs.store(ns, std::memory_order_relaxed);
+                device->stats.callbackNs.store(ns, std::memory_order_relaxed);
+            }
+            else
+            {
+                receive(self, val);
+            }
+        },  context());
+      }
     }
+  };
+
+  std::unique_ptr<Binding> _binding;
+
+  // Gives a moved-from Parameter a value and a binding of its own again, as a new Parameter
+  void revive()
+  {
+    if(_binding)
+      return;
+    // stop sharing the value with the Parameter it was moved to
+    ofParameter<DataValue> value;
+    this->makeReferenceTo(value);
+    _binding.reset(new Binding{*this});
+    _binding->_impl = std::make_shared<TypedParamNode<DataValue, Traits>> ();
   }
 
 public:
-  Parameter()
+  Parameter():
+    _binding{new Binding{*this}}
   {
-    _impl = std::make_shared<ParamNode> ();
+    _binding->_impl = std::make_shared<TypedParamNode<DataValue, Traits>> ();
   }
 
   void cloneFrom(const Parameter& other) {
-    _impl = other._impl;
-    if(other._callbackIt)
+    revive();
+    if(!other._binding)
     {
-      enableLocalUpdate();
-      enableRemoteUpdate();
+      // moved from: nothing to share
+      _binding->_impl = std::make_shared<TypedParamNode<DataValue, Traits>> ();
+      _binding->setCoalesced(false);
+      return;
+    }
+    _binding->_impl = other._binding->_impl;
+    _binding->setCoalesced(other.isCoalesced());
+    if(other._binding->_callbackIt)
+    {
+      _binding->enableLocalUpdate();
+      _binding->enableRemoteUpdate();
     }
   }
 
+  // A copy shares the node, with listeners of its own
+  // A copy of a moved-from Parameter is a new Parameter
   Parameter(const Parameter& other):
-    ofParameter<DataValue>{other}
+    ofParameter<DataValue>{other},
+    _binding{other._binding ? new Binding{*this} : nullptr}
   {
     cloneFrom(other);
   }
 
-  Parameter(Parameter&& other):
-    ofParameter<DataValue>{other}
+  // A move takes the listeners and the callback as they are, without calling libossia
+  // The moved-from Parameter has no node (getAddress() returns nullptr) until it is
+  // set up or assigned to again, as a new Parameter
+  Parameter(Parameter&& other) noexcept:
+    ofParameter<DataValue>{other},
+    _binding{std::move(other._binding)}
   {
-    cloneFrom(other);
   }
 
   Parameter& operator=(const Parameter& other)
   {
-    static_cast<ofParameter<DataValue>&>(*this) = other;
+    if(this == &other)
+      return *this;
 
-    cleanup();
+    revive();
+    _binding->cleanup();
+    // a moved-from Parameter shares its value with the one it was moved to: not copied
+    if(other._binding)
+      static_cast<ofParameter<DataValue>&>(*this) = other;
     cloneFrom(other);
     return *this;
   }
 
-  Parameter& operator=(Parameter&& other)
+  Parameter& operator=(Parameter&& other) noexcept
   {
-    static_cast<ofParameter<DataValue>&>(*this) = other;
-
-    cleanup();
-    cloneFrom(other);
+    if(this != &other)
+    {
+      if(_binding)
+        _binding->cleanup();
+      this->makeReferenceTo(other);
+      _binding = std::move(other._binding);
+    }
     return *this;
   }
 
   ~Parameter()
   {
-    cleanup();
+    if(_binding)
+      _binding->cleanup();
   }
 
   // creates node and sets the name, the data
@@ -134,15 +351,8 @@ public:
       const std::string& name,
       DataValue data)
   {
-    _impl->_parentNode = parentNode.getNode();
-    _impl->createNode(name, data);
-
-    enableLocalUpdate();
-    enableRemoteUpdate();
-    this->set(name, data);
-
-    parentNode.add(*this);
-    return *this;
+    createNode(parentNode, name, data);
+    return bind(parentNode);
   }
 
   // creates node and sets the name, the data, the minimum and maximum value (for the gui)
@@ -151,12 +361,53 @@ public:
       const std::string& name,
       DataValue data, DataValue min, DataValue max)
   {
-    _impl->_parentNode = parentNode.getNode();
-    _impl->createNode(name,data,min,max);
+    createNode(parentNode, name, data, min, max);
+    return bind(parentNode);
+  }
+
+  /**
+   * setup() in two steps, e.g. to create a whole subtree before any of its parameters
+   * can receive or publish a value (see ParameterGroup::build())
+   * createNode() creates the node with its value and domain, bind() then registers
+   * the listeners and the remote callback and adds the parameter to its group
+   **/
+
+  Parameter & createNode(
+      ossia::ParameterGroup & parentNode,
+      const std::string& name,
+      const DataValue& data)
+  {
+    revive();
+    _binding->_impl->_parentNode = parentNode.getNode();
+    _binding->_impl->_context = parentNode.getContext();
+    _binding->_impl->createNode(name, data);
 
-    enableLocalUpdate();
-    enableRemoteUpdate();
+    // set before listening: the node already has this value
+    this->set(name, data);
+    return *this;
+  }
+
+  Parameter & createNode(
+      ossia::ParameterGroup & parentNode,
+      const std::string& name,
+      const DataValue& data, const DataValue& min, const DataValue& max)
+  {
+    revive();
+    _binding->_impl->_parentNode = parentNode.getNode();
+    _binding->_impl->_context = parentNode.getContext();
+    _binding->_impl->createNode(name, data, min, max);
+
+    // set before listening: the node already has this value
     this->set(name, data, min, max);
+    return *this;
+  }
+
+  Parameter & bind(ossia::ParameterGroup & parentNode)
+  {
+    revive();
+    _binding->_impl->track(*this);
+    _binding->enableLocalUpdate();
+    _binding->enableRemoteUpdate();
 
     parentNode.add(*this);
     return *this;
@@ -168,22 +419,161 @@ public:
       const std::string& name,
       DataValue data, DataValue min, DataValue max)
   {
-    _impl->_parentNode = parentNode.getNode();
+    revive();
+    _binding->_impl->_parentNode = parentNode.getNode();
+    _binding->_impl->_context = parentNode.getContext();
     this->set(name, data, min, max);
 
     parentNode.add(*this);
+    return *this;
+  }
+
+  // Wraps an existing node of the same type, e.g. of an ofxOssiaMirror
+  // Name, value and domain (if any) are read from the node, which stays in the device
+  Parameter & attach(ossia::ParameterGroup & parentNode, opp::node node)
+  {
+    revive();
+    _binding->_impl->_context = parentNode.getContext();
+    _binding->_impl->_currentNode = node;
+
+    const auto value = _binding->_impl->template readNodeValue<DataValue, Traits>();
+    DataValue min{}, max{};
+    if(Conversion<Traits>::read(node.get_min(), min) && Conversion<Traits>::read(node.get_max(), max))
+      this->set(node.get_name(), value.value, min, max);
+    else
+      this->set(node.get_name(), value.value);
+    _binding->_impl->receivedValue(value.value);
+    _binding->_impl->track(*this);
+
+    _binding->enableLocalUpdate();
+    _binding->enableRemoteUpdate();
+
+    parentNode.add(*this);
+    return *this;
+  }
+
+  // Moves an attached parameter to another node of the same type,
+  // e.g. when a refresh of the mirror replaced its node
+  Parameter & rebind(opp::node node)
+  {
+    revive();
+    _binding->cleanup();
+    _binding->_impl->_currentNode = node;
+
+    const auto value = _binding->_impl->template readNodeValue<DataValue, Traits>();
+    _binding->_impl->receivedValue(value.value);
+    this->set(value.value);
+
+    _binding->enableLocalUpdate();
+    _binding->enableRemoteUpdate();
+    return *this;
   }
 
-  // Get the parameter of the node
+  // Get the parameter of the node (nullptr once moved from)
   opp::node* getAddress() const
   {
-    return _impl->_currentNode;
+    return _binding ? &_binding->_impl->_currentNode : nullptr;
+  }
+
+  /**
+   * Outbound filtering, to be called after setup()
+   * Also exposed to the clients through the refresh_rate, value_step_size
+   * and repetition_filter attributes of the node
+   **/
+
+  // At most hz messages per second (0: unlimited)
+  // Changes held back are sent by a later ofxOssia::flush(), to be called once per frame
+  Parameter & setMaxRate(float hz)
+  {
+    revive();
+    auto& filter = _binding->_impl->_filter;
+    filter.minInterval = hz > 0.f
+        ? std::chrono::duration_cast<PublishFilter::clock::duration>(std::chrono::duration<double>(1. / hz))
+        : PublishFilter::clock::duration{};
+
+    if(_binding->_impl->_currentNode.has_parameter())
+    {
+      if(hz > 0.f)
+        // in ms, rounded up: 0 would mean no limit to the clients
+        _binding->_impl->_currentNode.set_refresh_rate(std::max(1, int(std::ceil(1000.f / hz))));
+      else
+        _binding->_impl->_currentNode.unset_refresh_rate();
+    }
+    return *this;
+  }
+
+  // Changes smaller than delta (see Traits::distance()) from the last published value are not sent
+  // The node advertises it in its own units (see StepSize in OssiaTypes.h)
+  Parameter & setMinDelta(double delta)
+  {
+    revive();
+    _binding->_impl->_filter.minDelta = delta;
+
+    if(_binding->_impl->_currentNode.has_parameter())
+    {
+      const double step = delta > 0. ? StepSize<Traits>::of(delta) : 0.;
+      if(step > 0.)
+        _binding->_impl->_currentNode.set_value_step_size(step);
+      else
+        _binding->_impl->_currentNode.unset_value_step_size();
+    }
+    return *this;
+  }
+
+  // A value equal to the last published one is not sent again, even by update()
+  Parameter & setRepetitionFilter(bool filter)
+  {
+    revive();
+    _binding->_impl->_filter.repetitionFilter = filter;
+
+    if(_binding->_impl->_currentNode.has_parameter())
+      _binding->_impl->_currentNode.set_repetition_filter(filter);
+    return *this;
+  }
+
+  // Counters of this parameter (shared with its copies)
+  const Stats& getStats() const
+  {
+    static const Stats none{};
+    return _binding ? _binding->_impl->_stats : none;
+  }
+
+  // When coalescing, remote values overwrite each other until ofxOssia::drainInbound(),
+  // which applies only the latest one (whatever the device inbound mode)
+  Parameter & setCoalesced(bool coalesce)
+  {
+    revive();
+    _binding->setCoalesced(coalesce);
+    return *this;
+  }
+
+  bool isCoalesced() const
+  {
+    return _binding && _binding->_coalesce.load(std::memory_order_relaxed);
+  }
+
+  // Remote values received while coalescing
+  uint64_t getReceivedCount() const
+  {
+    if(!_binding || !_binding->_coalescing)
+      return 0;
+    return _binding->_coalescing->received();
+  }
+
+  // Remote values overwritten by a newer one before being applied
+  uint64_t getCollapsedCount() const
+  {
+    if(!_binding || !_binding->_coalescing)
+      return 0;
+    return _binding->_coalescing->collapsed();
   }
 
   // Updates value of the parameter and publish to the node
   void update(DataValue data)
   {
-    _impl->publishValue(data);
+    revive();
+    OriginScope scope{_binding->_impl.get(), Origin::Local};
+    _binding->publish(data);
 
     // change attribute value
     this->set(data);
@@ -8,6 +8,8 @@
 //
 
 #include "ParameterGroup.h"
+#include "ParameterSchema.h"
+#include <unordered_map>
 //#include "Parameter.h"
 
 namespace ossia { 
@@ -17,12 +19,15 @@ namespace ossia {
 
     ParameterGroup & ParameterGroup::setup(
                             opp::node parentNode,
-                            const std::string& name)
+                            const std::string& name,
+                            std::shared_ptr<DeviceContext> context)
     {
+        revive();
         //nodes->_parentNode = &parentNode;
         // TODO this is weird
         //_impl._parentNode = nullptr;
         _impl->_currentNode = parentNode;
+        _impl->_context = std::move(context);
         //_impl->createNode(name);
         this->setName(name);
         
@@ -33,15 +38,155 @@ namespace ossia {
                             ossia::ParameterGroup & parentNode,
                             const std::string& name)
     {
+        revive();
         _impl->_parentNode = parentNode.getNode();
+        _impl->_context = parentNode.getContext();
         _impl->createNode(name);
         this->setName(_impl->_currentNode.get_name());
         
         parentNode.add(*this);
+        _impl->_parentGroup.reset(new ofParameterGroup(parentNode));
         
         return *this;
     }
     
+    ParameterGroup & ParameterGroup::attach(
+                            ossia::ParameterGroup & parentNode,
+                            opp::node node)
+    {
+        revive();
+        _impl->_currentNode = node;
+        _impl->_context = parentNode.getContext();
+        _impl->_attached = true;
+        this->setName(node.get_name());
+
+        parentNode.add(*this);
+        _impl->_parentGroup.reset(new ofParameterGroup(parentNode));
+
+        return *this;
+    }
+
+    ParameterGroup & ParameterGroup::rebind(opp::node node)
+    {
+        revive();
+        _impl->_currentNode = node;
+        // the patterns of setAll() were resolved on the old node
+        _impl->_matches.clear();
+        return *this;
+    }
+
+    ParameterGroup & ParameterGroup::build(const ParameterSchema& schema)
+    {
+        revive();
+        auto& owned = _impl->_owned;
+        owned.reserve(owned.size() + schema.size());
+
+        // intermediate groups, by path relative to this group
+        std::unordered_map<std::string, ParameterGroup*> groups;
+        // parents of the parameters, in the order of the schema
+        std::vector<ParameterGroup*> parents;
+        parents.reserve(schema.size());
+
+        for(const auto& entry : schema.entries())
+        {
+            const std::string& path = entry->path;
+            ParameterGroup* parent = this;
+
+            std::size_t begin = 0;
+            std::size_t slash;
+            while((slash = path.find('/', begin)) != std::string::npos)
+            {
+                std::string prefix = path.substr(0, slash);
+                auto it = groups.find(prefix);
+                if(it == groups.end())
+                {
+                    std::unique_ptr<ParameterGroup> group{new ParameterGroup};
+                    group->setup(*parent, path.substr(begin, slash - begin));
+                    it = groups.emplace(std::move(prefix), group.get()).first;
+                    owned.push_back(std::move(group));
+                }
+                parent = it->second;
+                begin = slash + 1;
+            }
+
+            owned.push_back(entry->create(*parent, path.substr(begin)));
+            parents.push_back(parent);
+        }
+
+        // the whole subtree exists with its values: no value can be received
+        // or published before this point
+        const std::size_t first = owned.size() - parents.size();
+        for(std::size_t i = 0; i < parents.size(); i++)
+            schema.entries()[i]->bind(*owned[first + i], *parents[i]);
+
+        return *this;
+    }
+
+    void ParameterGroup::revive()
+    {
+        if(_impl)
+            return;
+        // the content was shared with the group it was moved to
+        ofParameterGroup::operator=(ofParameterGroup{});
+        _impl = std::make_shared<Node>();
+    }
+
+    void ParameterGroup::teardown()
+    {
+        if(!_impl)
+            return;
+
+        if(_impl->_attached)
+        {
+            // the branch stays in the device it belongs to
+            _impl->_currentNode = opp::node{};
+        }
+        else if(_impl->_currentNode && _impl->_parentNode)
+        {
+            // every opp::node of the branch becomes invalid
+            _impl->_parentNode.remove_child(_impl->_currentNode.get_name());
+            _impl->_currentNode = opp::node{};
+            _impl->_parentNode = opp::node{};
+        }
+        else if(_impl->_currentNode)
+        {
+            // root of the device: only its children go away
+            _impl->_currentNode.remove_children();
+        }
+
+        _impl->_owned.clear();
+
+        if(_impl->_parentGroup)
+        {
+            _impl->_parentGroup->remove(*this);
+            _impl->_parentGroup.reset();
+        }
+        this->clear();
+    }
+
+    const std::vector<AddressIndex::Entry>& ParameterGroup::matches(const std::string& pattern)
+    {
+        const AddressIndex& index = _impl->_context->index;
+        Matches& cached = _impl->_matches[pattern];
+        if(cached.resolved && cached.version == index.version())
+            return cached.entries;
+
+        cached.entries.clear();
+        cached.version = index.version();
+        cached.resolved = true;
+        if(!_impl->_currentNode)
+            return cached.entries;
+
+        // one walk of the tree, then lookups in the index
+        const std::string relative = !pattern.empty() && pattern[0] == '/' ? pattern.substr(1) : pattern;
+        for(const opp::node& node : _impl->_currentNode.find_children(relative))
+        {
+            if(const AddressIndex::Entry* entry = index.find(relativeAddress(node.get_address())))
+                cached.entries.push_back(*entry);
+        }
+        return cached.entries;
+    }
+
 //    ParameterGroup::~ParameterGroup(){
 //        while (this->size()>0){
 //            this->remove(this->back());
@@ -2,9 +2,16 @@
 #include <ossia-cpp98.hpp>
 #include <types/ofParameterGroup.h>
 #include "ParamNode.h"
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
 
 namespace ossia { 
 
+class ParameterSchema;
+
 /*
  * Class inheriting from ofParameterGroup
  * create ossia node + parameterGroup
@@ -14,32 +21,134 @@ class ParameterGroup : public ofParameterGroup
 {
 public:
     ParameterGroup() {
-        _impl = std::make_shared<ParamNode> ();
+        _impl = std::make_shared<Node> ();
     }
 
     ParameterGroup(const ParameterGroup&) = default;
-    ParameterGroup(ParameterGroup&&) = default;
     ParameterGroup& operator=(const ParameterGroup&) = default;
-    ParameterGroup& operator=(ParameterGroup&&) = default;
+
+    // Only the pointers change hands: the node, its children and the ofParameterGroup
+    // content are shared, nothing is registered again
+    // The moved-from group has no node: it can be set up again, as a new group
+    ParameterGroup(ParameterGroup&& other) noexcept:
+        ofParameterGroup(other),
+        _impl(std::move(other._impl)) {
+    }
+
+    ParameterGroup& operator=(ParameterGroup&& other) noexcept {
+        ofParameterGroup::operator=(other);
+        _impl = std::move(other._impl);
+        return *this;
+    }
 
     ~ParameterGroup() = default;
 
     ParameterGroup & setup(opp::node parentNode,
-                           const std::string& name);
+                           const std::string& name,
+                           std::shared_ptr<DeviceContext> context = {});
 
     ParameterGroup & setup(ossia::ParameterGroup & parentNode,
                            const std::string& name);
     
+    /**
+     * Wraps an existing node, e.g. of an ofxOssiaMirror: nothing is created in the device,
+     * and teardown() or the destruction of the group leave the node there
+     **/
+    ParameterGroup & attach(ossia::ParameterGroup & parentNode,
+                            opp::node node);
+
+    /**
+     * Moves an attached group to another node at the same address,
+     * e.g. when a refresh of the mirror replaced its node
+     **/
+    ParameterGroup & rebind(opp::node node);
+
+    /**
+     * Creates the whole subtree described by the schema: every node with its value
+     * and domain first, then the listeners and remote callbacks of the parameters,
+     * so that nothing is received or published while the subtree is incomplete
+     * Each node costs the same as with Parameter::setup(), and is announced on its own
+     * The parameters and groups created are owned by this group
+     **/
+    ParameterGroup & build(const ParameterSchema& schema);
+
+    /**
+     * Removes the whole branch at once: one call to libossia for the subtree,
+     * the parameters destroyed afterwards do not touch the library anymore
+     * The parameters owned by this group (see build()) are destroyed,
+     * and the group is removed from its parent ofParameterGroup
+     **/
+    void teardown();
+
+    /**
+     * Sets every parameter of this type matching the pattern (relative to this group,
+     * e.g. "circle.+/colorParams/fill"), published as one batch
+     * The pattern is resolved once, then kept until parameters are added to
+     * or removed from the device
+     * Returns the number of parameters set
+     **/
+    template<typename DataValue>
+    std::size_t setAll(const std::string& pattern, const DataValue& value)
+    {
+        const auto& device = getContext();
+        if(!device)
+            return 0;
+
+        std::size_t count = 0;
+        DeviceContext::ScopedBatch batch{device.get()};
+        for(const AddressIndex::Entry& entry : matches(pattern))
+        {
+            // nodes torn down are not part of the device anymore
+            if(*entry.type == typeid(DataValue) && entry.node->_currentNode)
+            {
+                static_cast<ofParameter<DataValue>*>(entry.parameter)->set(value);
+                count++;
+            }
+        }
+        return count;
+    }
+
 //    void createNode(const std::string& name);
 
     opp::node getNode() const{
-    return _impl->_currentNode;
+    return _impl ? _impl->_currentNode : opp::node{};
+    }
+
+    // Device state shared by the whole tree (may be null if not built from ofxOssia, or moved from)
+    const std::shared_ptr<DeviceContext>& getContext() const{
+    static const std::shared_ptr<DeviceContext> none;
+    return _impl ? _impl->_context : none;
     }
 
 //    void clearNode();
 
 private:
-    std::shared_ptr<ParamNode> _impl{};
+    // Gives a moved-from group a node and a content of its own again
+    void revive();
+
+    // Parameters of the device matching the pattern, from the cache if still valid
+    const std::vector<AddressIndex::Entry>& matches(const std::string& pattern);
+
+    struct Matches
+    {
+      uint64_t version{};
+      bool resolved{false};
+      std::vector<AddressIndex::Entry> entries;
+    };
+
+    struct Node : ParamNode
+    {
+      // parameters created by build(), destroyed before the node itself
+      std::vector<std::unique_ptr<ofAbstractParameter>> _owned;
+      // shares the parent ofParameterGroup, to leave it in teardown()
+      std::unique_ptr<ofParameterGroup> _parentGroup;
+      // the node belongs to someone else, see attach()
+      bool _attached{false};
+      // patterns resolved by setAll()
+      std::unordered_map<std::string, Matches> _matches;
+    };
+
+    std::shared_ptr<Node> _impl{};
 
 };
 } // namespace ossia 
@@ -0,0 +1,107 @@
+#pragma once
+#include "Parameter.h"
+#include "ParameterGroup.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ossia
+{
+
+/*
+ * Declarative description of a subtree of parameters, created by a single call to ParameterGroup::build()
+ * Paths are relative to the group and "/" separated: intermediate groups are created once
+ * e.g. schema.add("circle/radius", 50.f, 1.f, 100.f);
+ **/
+
+class ParameterSchema
+{
+public:
+  class Entry
+  {
+  public:
+    explicit Entry(std::string p): path(std::move(p)) { }
+    virtual ~Entry() = default;
+
+    // Creates the parameter and its node, named name, under parent (see Parameter::createNode())
+    virtual std::unique_ptr<ofAbstractParameter> create(ParameterGroup& parent,
+                                                        const std::string& name) const = 0;
+
+    // Registers the callbacks of a parameter returned by create() (see Parameter::bind())
+    virtual void bind(ofAbstractParameter& parameter, ParameterGroup& parent) const = 0;
+
+    std::string path;
+  };
+
+  void reserve(std::size_t count)
+  {
+    _entries.reserve(count);
+  }
+
+  std::size_t size() const
+  {
+    return _entries.size();
+  }
+
+  const std::vector<std::unique_ptr<Entry>>& entries() const
+  {
+    return _entries;
+  }
+
+  // Traits as in Parameter<DataValue, Traits>
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  ParameterSchema& add(std::string path, DataValue data)
+  {
+    _entries.emplace_back(new TypedEntry<DataValue, Traits>(std::move(path), std::move(data)));
+    return *this;
+  }
+
+  template<typename DataValue, typename Traits = MatchingType<DataValue>>
+  ParameterSchema& add(std::string path, DataValue data, DataValue min, DataValue max)
+  {
+    static_assert(AdvertisesDomain<Traits>::value, "the node of this type can't have a min and max");
+    _entries.emplace_back(new TypedEntry<DataValue, Traits>(std::move(path), std::move(data),
+                                                            std::move(min), std::move(max)));
+    return *this;
+  }
+
+private:
+  template<typename DataValue, typename Traits>
+  class TypedEntry : public Entry
+  {
+  public:
+    TypedEntry(std::string p, DataValue d):
+      Entry(std::move(p)), data(std::move(d))
+    { }
+
+    TypedEntry(std::string p, DataValue d, DataValue mi, DataValue ma):
+      Entry(std::move(p)), data(std::move(d)), min(std::move(mi)), max(std::move(ma)), hasDomain(true)
+    { }
+
+    std::unique_ptr<ofAbstractParameter> create(ParameterGroup& parent,
+                                                const std::string& name) const override
+    {
+      auto param = new Parameter<DataValue, Traits>;
+      std::unique_ptr<ofAbstractParameter> owned{param};
+      if(hasDomain)
+        param->createNode(parent, name, data, min, max);
+      else
+        param->createNode(parent, name, data);
+      return owned;
+    }
+
+    void bind(ofAbstractParameter& parameter, ParameterGroup& parent) const override
+    {
+      static_cast<Parameter<DataValue, Traits>&>(parameter).bind(parent);
+    }
+
+    DataValue data;
+    DataValue min{};
+    DataValue max{};
+    bool hasDomain{false};
+  };
+
+  std::vector<std::unique_ptr<Entry>> _entries;
+};
+
+} // namespace ossia
@@ -0,0 +1,342 @@
+//
+//  PresetBank.cpp
+//  ofxOSSIA
+//
+
+#include "PresetBank.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace ossia {
+
+    namespace {
+        using State = PresetBank::State;
+
+        // Components of the types interpolated as floats
+        template<typename T> struct Lanes;
+
+        template<> struct Lanes<float> {
+            static constexpr std::size_t size = 1;
+            static void read(const float& v, float* out){ out[0] = v; }
+            static float write(const float* in){ return in[0]; }
+        };
+
+        template<typename Vec, std::size_t N> struct VecLanes {
+            static constexpr std::size_t size = N;
+            static void read(const Vec& v, float* out){ for(int i = 0; i < int(N); i++) out[i] = v[i]; }
+            static Vec write(const float* in){ Vec v; for(int i = 0; i < int(N); i++) v[i] = in[i]; return v; }
+        };
+
+        template<> struct Lanes<ofVec2f> : VecLanes<ofVec2f, 2> { };
+        template<> struct Lanes<ofVec3f> : VecLanes<ofVec3f, 3> { };
+        template<> struct Lanes<ofVec4f> : VecLanes<ofVec4f, 4> { };
+        template<> struct Lanes<glm::vec2> : VecLanes<glm::vec2, 2> { };
+        template<> struct Lanes<glm::vec3> : VecLanes<glm::vec3, 3> { };
+        template<> struct Lanes<glm::vec4> : VecLanes<glm::vec4, 4> { };
+
+        template<> struct Lanes<ofFloatColor> {
+            static constexpr std::size_t size = 4;
+            static void read(const ofFloatColor& c, float* out){ out[0] = c.r; out[1] = c.g; out[2] = c.b; out[3] = c.a; }
+            static ofFloatColor write(const float* in){ return ofFloatColor(in[0], in[1], in[2], in[3]); }
+        };
+
+        template<> struct Lanes<ofColor> {
+            static constexpr std::size_t size = 4;
+            static void read(const ofColor& c, float* out){ out[0] = c.r; out[1] = c.g; out[2] = c.b; out[3] = c.a; }
+            static ofColor write(const float* in)
+            {
+                return ofColor(std::round(in[0]), std::round(in[1]), std::round(in[2]), std::round(in[3]));
+            }
+        };
+
+        template<typename T>
+        const T& value(const ofAbstractParameter& parameter)
+        {
+            return static_cast<const ofParameter<T>&>(parameter).get();
+        }
+
+        template<typename T>
+        void set(ofAbstractParameter& parameter, const T& v)
+        {
+            static_cast<ofParameter<T>&>(parameter).set(v);
+        }
+
+        // Where each kind of value is stored in a State, and how it is mixed
+        template<typename T>
+        struct FloatKind {
+            static std::size_t reserve(State& layout)
+            {
+                const std::size_t index = layout.floats.size();
+                layout.floats.resize(index + Lanes<T>::size);
+                return index;
+            }
+            static void read(const ofAbstractParameter& p, State& s, std::size_t i)
+            {
+                Lanes<T>::read(value<T>(p), &s.floats[i]);
+            }
+            static void write(ofAbstractParameter& p, const State& mix, const State&, std::size_t i)
+            {
+                set<T>(p, Lanes<T>::write(&mix.floats[i]));
+            }
+            static bool differs(const State& a, const State& b, std::size_t i)
+            {
+                return !std::equal(&a.floats[i], &a.floats[i] + Lanes<T>::size, &b.floats[i]);
+            }
+            static void copy(const State& a, std::size_t i, State& b, std::size_t j)
+            {
+                std::copy(&a.floats[i], &a.floats[i] + Lanes<T>::size, &b.floats[j]);
+            }
+        };
+
+        struct DoubleKind {
+            static std::size_t reserve(State& layout)
+            {
+                layout.doubles.emplace_back();
+                return layout.doubles.size() - 1;
+            }
+            static void read(const ofAbstractParameter& p, State& s, std::size_t i){ s.doubles[i] = value<double>(p); }
+            static void write(ofAbstractParameter& p, const State& mix, const State&, std::size_t i){ set<double>(p, mix.doubles[i]); }
+            static bool differs(const State& a, const State& b, std::size_t i){ return a.doubles[i] != b.doubles[i]; }
+            static void copy(const State& a, std::size_t i, State& b, std::size_t j){ b.doubles[j] = a.doubles[i]; }
+        };
+
+        struct IntKind {
+            static std::size_t reserve(State& layout)
+            {
+                layout.ints.emplace_back();
+                return layout.ints.size() - 1;
+            }
+            static void read(const ofAbstractParameter& p, State& s, std::size_t i){ s.ints[i] = value<int>(p); }
+            static void write(ofAbstractParameter& p, const State& mix, const State&, std::size_t i){ set<int>(p, mix.ints[i]); }
+            static bool differs(const State& a, const State& b, std::size_t i){ return a.ints[i] != b.ints[i]; }
+            static void copy(const State& a, std::size_t i, State& b, std::size_t j){ b.ints[j] = a.ints[i]; }
+        };
+
+        struct BoolKind {
+            static std::size_t reserve(State& layout)
+            {
+                layout.bools.emplace_back();
+                return layout.bools.size() - 1;
+            }
+            static void read(const ofAbstractParameter& p, State& s, std::size_t i){ s.bools[i] = value<bool>(p); }
+            static void write(ofAbstractParameter& p, const State&, const State& discrete, std::size_t i){ set<bool>(p, discrete.bools[i] != 0); }
+            static bool differs(const State& a, const State& b, std::size_t i){ return a.bools[i] != b.bools[i]; }
+            static void copy(const State& a, std::size_t i, State& b, std::size_t j){ b.bools[j] = a.bools[i]; }
+        };
+
+        struct StringKind {
+            static std::size_t reserve(State& layout)
+            {
+                layout.strings.emplace_back();
+                return layout.strings.size() - 1;
+            }
+            static void read(const ofAbstractParameter& p, State& s, std::size_t i){ s.strings[i] = value<std::string>(p); }
+            static void write(ofAbstractParameter& p, const State&, const State& discrete, std::size_t i){ set<std::string>(p, discrete.strings[i]); }
+            static bool differs(const State& a, const State& b, std::size_t i){ return a.strings[i] != b.strings[i]; }
+            static void copy(const State& a, std::size_t i, State& b, std::size_t j){ b.strings[j] = a.strings[i]; }
+        };
+
+        // out = a + (b - a) * t, over whole arrays: a loop the compiler vectorizes
+        void lerp(const float* a, const float* b, float* out, std::size_t n, float t)
+        {
+            for(std::size_t i = 0; i < n; i++)
+                out[i] = a[i] + (b[i] - a[i]) * t;
+        }
+
+        void lerp(const double* a, const double* b, double* out, std::size_t n, double t)
+        {
+            for(std::size_t i = 0; i < n; i++)
+                out[i] = a[i] + (b[i] - a[i]) * t;
+        }
+
+        void lerp(const int* a, const int* b, int* out, std::size_t n, float t)
+        {
+            for(std::size_t i = 0; i < n; i++)
+                out[i] = a[i] + int(std::lround(float(b[i] - a[i]) * t));
+        }
+    }
+
+    PresetBank::PresetBank(const ParameterGroup& group):
+        _group(group)
+    {
+        rescan();
+    }
+
+    template<typename T, typename Kind>
+    bool PresetBank::bind(const std::shared_ptr<ofAbstractParameter>& parameter)
+    {
+        if(!dynamic_cast<ofParameter<T>*>(parameter.get()))
+            return false;
+
+        _bindings.push_back({parameter, Kind::reserve(_layout), &Kind::read, &Kind::write, &Kind::differs, &Kind::copy});
+        return true;
+    }
+
+    void PresetBank::scan(ofParameterGroup& group)
+    {
+        for(auto& parameter : group)
+        {
+            if(auto subgroup = std::dynamic_pointer_cast<ofParameterGroup>(parameter))
+            {
+                scan(*subgroup);
+                continue;
+            }
+
+            bind<float, FloatKind<float>>(parameter)
+                || bind<ofVec2f, FloatKind<ofVec2f>>(parameter)
+                || bind<ofVec3f, FloatKind<ofVec3f>>(parameter)
+                || bind<ofVec4f, FloatKind<ofVec4f>>(parameter)
+                || bind<glm::vec2, FloatKind<glm::vec2>>(parameter)
+                || bind<glm::vec3, FloatKind<glm::vec3>>(parameter)
+                || bind<glm::vec4, FloatKind<glm::vec4>>(parameter)
+                || bind<ofColor, FloatKind<ofColor>>(parameter)
+                || bind<ofFloatColor, FloatKind<ofFloatColor>>(parameter)
+                || bind<double, DoubleKind>(parameter)
+                || bind<int, IntKind>(parameter)
+                || bind<bool, BoolKind>(parameter)
+                || bind<std::string, StringKind>(parameter);
+        }
+    }
+
+    void PresetBank::rescan()
+    {
+        std::vector<Binding> previous;
+        previous.swap(_bindings);
+        _layout = State{};
+        scan(_group);
+        if(const auto& context = _group.getContext())
+            _version = context->index.version();
+
+        // the presets (and the start of a running transition) move to the new layout
+        std::unordered_map<const ofAbstractParameter*, const Binding*> kept;
+        for(const auto& binding : previous)
+            kept.emplace(binding.parameter.get(), &binding);
+        const auto remap = [&] (State& state) {
+            State remapped = _layout;
+            read(remapped);
+            for(const auto& binding : _bindings)
+            {
+                auto it = kept.find(binding.parameter.get());
+                if(it != kept.end())
+                    binding.copy(state, it->second->index, remapped, binding.index);
+            }
+            state = std::move(remapped);
+        };
+        for(auto& preset : _presets)
+            remap(preset);
+        remap(_from);
+        _mix = _layout;
+    }
+
+    void PresetBank::checkLayout()
+    {
+        const auto& context = _group.getContext();
+        if(context && context->index.version() != _version)
+            rescan();
+    }
+
+    void PresetBank::read(State& state) const
+    {
+        for(const auto& binding : _bindings)
+            binding.read(*binding.parameter, state, binding.index);
+    }
+
+    std::size_t PresetBank::capture()
+    {
+        checkLayout();
+        _presets.push_back(_layout);
+        read(_presets.back());
+        return _presets.size() - 1;
+    }
+
+    void PresetBank::capture(std::size_t preset)
+    {
+        checkLayout();
+        if(preset < _presets.size())
+            read(_presets[preset]);
+    }
+
+    std::size_t PresetBank::size() const
+    {
+        return _presets.size();
+    }
+
+    std::size_t PresetBank::getParameterCount() const
+    {
+        return _bindings.size();
+    }
+
+    void PresetBank::apply(const State& from, const State& to, float position)
+    {
+        position = std::min(std::max(position, 0.f), 1.f);
+
+        lerp(from.floats.data(), to.floats.data(), _mix.floats.data(), _mix.floats.size(), position);
+        lerp(from.doubles.data(), to.doubles.data(), _mix.doubles.data(), _mix.doubles.size(), position);
+        lerp(from.ints.data(), to.ints.data(), _mix.ints.data(), _mix.ints.size(), position);
+        const State& discrete = position < 0.5f ? from : to;
+
+        // parameters equal in both states are left as they are
+        DeviceContext::ScopedBatch batch{_group.getContext().get()};
+        for(const auto& binding : _bindings)
+        {
+            if(binding.differs(from, to, binding.index))
+                binding.write(*binding.parameter, _mix, discrete, binding.index);
+        }
+    }
+
+    void PresetBank::recall(std::size_t preset)
+    {
+        checkLayout();
+        if(preset >= _presets.size())
+            return;
+
+        _running = false;
+        read(_from);
+        apply(_from, _presets[preset], 1.f);
+    }
+
+    void PresetBank::transition(std::size_t preset, float seconds)
+    {
+        checkLayout();
+        if(preset >= _presets.size())
+            return;
+        if(seconds <= 0.f)
+            return recall(preset);
+
+        read(_from);
+        _target = preset;
+        _start = std::chrono::steady_clock::now();
+        _duration = std::chrono::duration<float>(seconds);
+        _running = true;
+    }
+
+    void PresetBank::crossfade(std::size_t from, std::size_t to, float position)
+    {
+        checkLayout();
+        if(from >= _presets.size() || to >= _presets.size())
+            return;
+
+        _running = false;
+        apply(_presets[from], _presets[to], position);
+    }
+
+    bool PresetBank::update()
+    {
+        if(!_running)
+            return false;
+        checkLayout();
+
+        const float position = (std::chrono::steady_clock::now() - _start) / _duration;
+        if(position >= 1.f)
+            _running = false;
+
+        apply(_from, _presets[_target], position);
+        return true;
+    }
+
+    bool PresetBank::isTransitioning() const
+    {
+        return _running;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "ParameterGroup.h"
+#include <types/ofParameterGroup.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ossia
+{
+
+/*
+ * Presets of the parameters of a ParameterGroup (and of its subgroups), kept in memory
+ * Each preset stores its values in one contiguous array per kind of value:
+ * the components of float parameters, vectors and colors are interpolated together
+ * in a single loop, ints are rounded, bools and strings switch halfway
+ * The results are published as one batch per frame
+ * Supported: float, double, int, bool, std::string, ofVec2f/3f/4f, glm::vec2/3/4, ofColor, ofFloatColor
+ **/
+
+class PresetBank
+{
+public:
+  // The bank shares the group (its content and its node), which can then be moved or copied
+  explicit PresetBank(const ParameterGroup& group);
+
+  // Looks for the parameters of the group again: the parameters still there keep their values
+  // in the presets, the new ones get their current value
+  // Done by the other methods when parameters were added to or removed from the device since
+  // the last scan, needed only for a group built without ofxOssia (no address index)
+  void rescan();
+
+  // Stores the current values as a new preset, returns its index
+  std::size_t capture();
+  // Overwrites a preset with the current values
+  void capture(std::size_t preset);
+
+  std::size_t size() const;
+
+  // Jumps to a preset
+  void recall(std::size_t preset);
+
+  // Goes from the current values to a preset, in seconds, advanced by update()
+  void transition(std::size_t preset, float seconds);
+
+  // Sets the mix of two presets, position being in [0, 1]
+  void crossfade(std::size_t from, std::size_t to, float position);
+
+  // Advances the running transition, to be called once per frame
+  // Returns false when no transition is running
+  bool update();
+
+  bool isTransitioning() const;
+
+  // Number of parameters handled by the bank
+  std::size_t getParameterCount() const;
+
+  // Values of all the parameters, one array per kind
+  struct State
+  {
+    std::vector<float> floats; // every component of floats, vectors and colors
+    std::vector<double> doubles;
+    std::vector<int> ints;
+    std::vector<uint8_t> bools;
+    std::vector<std::string> strings;
+  };
+
+  // A parameter and the position of its values in the arrays of its kind
+  struct Binding
+  {
+    std::shared_ptr<ofAbstractParameter> parameter;
+    std::size_t index;
+    void (*read)(const ofAbstractParameter&, State&, std::size_t index);
+    // interpolated kinds are read from mix, the others from discrete
+    void (*write)(ofAbstractParameter&, const State& mix, const State& discrete, std::size_t index);
+    bool (*differs)(const State&, const State&, std::size_t index);
+    // copies the values of the parameter from a state to another of a different layout
+    void (*copy)(const State& from, std::size_t fromIndex, State& to, std::size_t toIndex);
+  };
+
+private:
+  void scan(ofParameterGroup& group);
+  template<typename T, typename Kind>
+  bool bind(const std::shared_ptr<ofAbstractParameter>& parameter);
+
+  void checkLayout();
+  void read(State& state) const;
+  void apply(const State& from, const State& to, float position);
+
+  ParameterGroup _group;
+  uint64_t _version{}; // of the address index of the device when scanned
+  std::vector<Binding> _bindings;
+  State _layout; // sizes of the arrays
+  std::vector<State> _presets;
+
+  // running transition
+  State _from;
+  State _mix;
+  std::size_t _target{};
+  std::chrono::steady_clock::time_point _start{};
+  std::chrono::duration<float> _duration{};
+  bool _running{false};
+};
+
+} // namespace ossia
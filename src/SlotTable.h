@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ossia
+{
+
+/*
+ * Generation-indexed table of the targets of the remote callbacks and of the device queues
+ * A handle packs the index of a slot and its generation: releasing the slot bumps the generation,
+ * so a handle outliving its target resolves to nullptr instead of a dangling pointer
+ * resolve() is lock-free and can be called from the network threads,
+ * acquire() and release() take a lock (setup and destruction of parameters only)
+ * The libossia callbacks only carry a void*, so there is one table for the whole process
+ **/
+
+class SlotTable
+{
+public:
+  using Handle = uintptr_t; // 0 is never a valid handle
+
+  static SlotTable& instance()
+  {
+    // never destroyed: handles can still be resolved during static destruction
+    static SlotTable* table = new SlotTable;
+    return *table;
+  }
+
+  SlotTable(const SlotTable&) = delete;
+  SlotTable& operator=(const SlotTable&) = delete;
+
+  Handle acquire(void* target)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t index;
+    if(!_free.empty())
+    {
+      index = _free.back();
+      _free.pop_back();
+    }
+    else
+    {
+      index = _size;
+      const std::size_t chunk = index / chunk_size;
+      if(chunk == max_chunks || index > index_mask)
+        return 0;
+      if(!_chunks[chunk].load(std::memory_order_relaxed))
+        _chunks[chunk].store(new Slot[chunk_size], std::memory_order_release);
+      _size++;
+    }
+
+    Slot& slot = at(index);
+    slot.target.store(target, std::memory_order_release);
+    return (Handle(slot.generation.load(std::memory_order_relaxed)) << index_bits) | index;
+  }
+
+  // The handle resolves to nullptr from now on
+  void release(Handle handle)
+  {
+    if(!handle)
+      return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const uint32_t index = uint32_t(handle & index_mask);
+    Slot& slot = at(index);
+    if(slot.generation.load(std::memory_order_relaxed) != generationOf(handle))
+      return;
+
+    slot.target.store(nullptr, std::memory_order_relaxed);
+    // 0 is skipped so that no handle is 0
+    uint32_t next = (slot.generation.load(std::memory_order_relaxed) + 1) & generation_mask;
+    slot.generation.store(next ? next : 1, std::memory_order_release);
+    _free.push_back(index);
+  }
+
+  // The target of the handle, nullptr if it was released
+  void* resolve(Handle handle) const
+  {
+    const std::size_t index = handle & index_mask;
+    const std::size_t chunk = index / chunk_size;
+    const Slot* slots = chunk < max_chunks ? _chunks[chunk].load(std::memory_order_acquire) : nullptr;
+    if(slots)
+    {
+      // the generation is read again: the slot may have been released and reused meanwhile
+      const Slot& slot = slots[index % chunk_size];
+      const uint32_t generation = generationOf(handle);
+      if(slot.generation.load(std::memory_order_acquire) == generation)
+      {
+        void* target = slot.target.load(std::memory_order_acquire);
+        if(target && slot.generation.load(std::memory_order_acquire) == generation)
+          return target;
+      }
+    }
+    _stale.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // Handles resolved after their release
+  uint64_t getStaleCount() const
+  {
+    return _stale.load(std::memory_order_relaxed);
+  }
+
+  static void* toContext(Handle handle)
+  {
+    return reinterpret_cast<void*>(handle);
+  }
+
+  static Handle fromContext(void* context)
+  {
+    return reinterpret_cast<Handle>(context);
+  }
+
+private:
+  SlotTable() = default;
+
+  // half of the bits for the index, half for the generation
+  static constexpr unsigned index_bits = sizeof(Handle) * 4;
+  static constexpr Handle index_mask = (Handle(1) << index_bits) - 1;
+  static constexpr uint32_t generation_mask = uint32_t((uint64_t(1) << index_bits) - 1);
+  static constexpr std::size_t chunk_size = 1024;
+  static constexpr std::size_t max_chunks = 4096;
+
+  struct Slot
+  {
+    std::atomic<uint32_t> generation{1};
+    std::atomic<void*> target{nullptr};
+  };
+
+  static uint32_t generationOf(Handle handle)
+  {
+    return uint32_t(handle >> index_bits);
+  }
+
+  Slot& at(uint32_t index)
+  {
+    return _chunks[index / chunk_size].load(std::memory_order_relaxed)[index % chunk_size];
+  }
+
+  // chunks never move once allocated, so that resolve() needs no lock
+  std::atomic<Slot*> _chunks[max_chunks]{};
+  uint32_t _size{0};
+  std::vector<uint32_t> _free;
+  std::mutex _mutex;
+  mutable std::atomic<uint64_t> _stale{0};
+};
+
+} // namespace ossia
@@ -0,0 +1,198 @@
+#pragma once
+#include "OssiaTypes.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace ossia
+{
+
+/*
+ * Binary layout of the values in a snapshot (see ofxOssia::saveSnapshot())
+ * write() appends the value, read() returns false when the size of the bytes can't be
+ * the one of a T: values of the same size are told apart by the typeId() stored with them
+ * Values are in the byte order of the machine and type ids depend on the compiler:
+ * snapshots are meant to be reloaded by the same application
+ **/
+
+namespace snapshot
+{
+// Id of a type and its Traits, e.g. to not read a float as an int or an ofVec4f as an ofFloatColor
+template<typename T, typename Traits>
+uint32_t typeId()
+{
+  static const uint32_t id = [] {
+    // FNV-1a of the mangled name
+    uint32_t hash = 2166136261u;
+    for(const char* c = typeid(std::pair<T, Traits>).name(); *c; c++)
+      hash = (hash ^ uint8_t(*c)) * 16777619u;
+    return hash;
+  }();
+  return id;
+}
+
+inline void writeSize(std::size_t size, std::string& out)
+{
+  const uint32_t s = uint32_t(size);
+  out.append(reinterpret_cast<const char*>(&s), sizeof(s));
+}
+
+// Reads a size and moves data past it
+inline bool readSize(const char*& data, const char* end, std::size_t& size)
+{
+  uint32_t s;
+  if(std::size_t(end - data) < sizeof(s))
+    return false;
+  std::memcpy(&s, data, sizeof(s));
+  data += sizeof(s);
+  size = s;
+  return true;
+}
+
+// Wire types of MatchingType: plain structs, strings and lists of numbers
+template<typename W>
+void writeWire(const W& w, std::string& out)
+{
+  static_assert(std::is_trivially_copyable<W>::value, "no snapshot layout for this wire type");
+  out.append(reinterpret_cast<const char*>(&w), sizeof(W));
+}
+
+inline void writeWire(const std::string& w, std::string& out)
+{
+  out.append(w);
+}
+
+inline void writeWire(const std::vector<opp::value>& w, std::string& out)
+{
+  for(const opp::value& element : w)
+  {
+    const float f = element.is_int() ? float(element.to_int()) : element.to_float();
+    out.append(reinterpret_cast<const char*>(&f), sizeof(f));
+  }
+}
+
+template<typename W>
+bool readWire(const char* data, std::size_t size, opp::value& v)
+{
+  W w;
+  if(size != sizeof(W))
+    return false;
+  std::memcpy(&w, data, sizeof(W));
+  v = opp::value(w);
+  return true;
+}
+
+template<>
+inline bool readWire<std::string>(const char* data, std::size_t size, opp::value& v)
+{
+  v = opp::value(std::string(data, size));
+  return true;
+}
+
+template<>
+inline bool readWire<std::vector<opp::value>>(const char* data, std::size_t size, opp::value& v)
+{
+  if(size % sizeof(float))
+    return false;
+  std::vector<opp::value> list;
+  list.reserve(size / sizeof(float));
+  for(std::size_t i = 0; i < size; i += sizeof(float))
+  {
+    float f;
+    std::memcpy(&f, data + i, sizeof(f));
+    list.emplace_back(f);
+  }
+  v = opp::value(std::move(list));
+  return true;
+}
+}
+
+// Other types: through their wire type
+template<typename T, typename Traits = MatchingType<T>, typename = void>
+struct SnapshotValue {
+    using wire_type = typename std::decay<decltype(Traits::convert(std::declval<const T&>()))>::type;
+
+    static void write(const T& value, std::string& out)
+    {
+      snapshot::writeWire(Traits::convert(value), out);
+    }
+
+    static bool read(const char* data, std::size_t size, T& value)
+    {
+      opp::value v;
+      if(!snapshot::readWire<wire_type>(data, size, v) || !Traits::is_valid(v))
+        return false;
+      value = Traits::convertFromOssia(v);
+      return true;
+    }
+};
+
+// Plain types (numbers, vectors, colors...) are copied as they are
+template<typename T, typename Traits>
+struct SnapshotValue<T, Traits, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+    static void write(const T& value, std::string& out)
+    {
+      out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static bool read(const char* data, std::size_t size, T& value)
+    {
+      if(size != sizeof(T))
+        return false;
+      std::memcpy(&value, data, sizeof(T));
+      return true;
+    }
+};
+
+// Contiguous data: the bytes of the elements
+template<typename T, typename Traits>
+struct SnapshotValue<std::vector<T>, Traits, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static void write(const std::vector<T>& value, std::string& out)
+    {
+      out.append(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(T));
+    }
+
+    static bool read(const char* data, std::size_t size, std::vector<T>& value)
+    {
+      if(size % sizeof(T))
+        return false;
+      value.resize(size / sizeof(T));
+      if(size)
+        std::memcpy(value.data(), data, size);
+      return true;
+    }
+};
+
+template<typename Traits>
+struct SnapshotValue<std::string, Traits> {
+    static void write(const std::string& value, std::string& out)
+    {
+      out.append(value);
+    }
+
+    static bool read(const char* data, std::size_t size, std::string& value)
+    {
+      value.assign(data, size);
+      return true;
+    }
+};
+
+template<typename Traits>
+struct SnapshotValue<ofBuffer, Traits> {
+    static void write(const ofBuffer& value, std::string& out)
+    {
+      out.append(value.getData(), value.size());
+    }
+
+    static bool read(const char* data, std::size_t size, ofBuffer& value)
+    {
+      value.set(data, size);
+      return true;
+    }
+};
+
+} // namespace ossia
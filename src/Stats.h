@@ -0,0 +1,31 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace ossia
+{
+
+/*
+ * Lock-free counters of a parameter or of a whole device
+ * Updated from the network threads and the main thread, can be read from anywhere
+ **/
+
+struct Stats
+{
+  std::atomic<uint64_t> received{0};   // values received from the network
+  std::atomic<uint64_t> published{0};  // values sent to the network
+  std::atomic<uint64_t> mismatches{0}; // values received with a type not matching the parameter
+  std::atomic<uint64_t> callbackNs{0}; // duration of the last remote callback, if timed
+
+  static void count(std::atomic<uint64_t>& counter)
+  {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static uint64_t read(const std::atomic<uint64_t>& counter)
+  {
+    return counter.load(std::memory_order_relaxed);
+  }
+};
+
+} // namespace ossia
@@ -0,0 +1,90 @@
+//
+//  Thumbnail.cpp
+//  ofxOSSIA
+//
+
+#include "Thumbnail.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ossia {
+
+    namespace {
+        constexpr std::size_t header_size = 5;
+        constexpr std::size_t max_side = 0xFFFF;
+    }
+
+    void packThumbnail(const ofPixels& pixels, std::size_t maxSize, ofBuffer& buffer){
+        const std::size_t srcWidth = pixels.getWidth();
+        const std::size_t srcHeight = pixels.getHeight();
+        const std::size_t channels = pixels.getNumChannels();
+
+        // nothing to sample: a 0x0 header, which unpackThumbnail() rejects
+        if(srcWidth == 0 || srcHeight == 0 || channels == 0 || !pixels.getData()){
+            buffer.allocate(header_size);
+            std::memset(buffer.getData(), 0, header_size);
+            return;
+        }
+
+        maxSize = std::min(std::max<std::size_t>(maxSize, 1), max_side);
+        std::size_t width = srcWidth;
+        std::size_t height = srcHeight;
+        if(std::max(width, height) > maxSize){
+            if(width >= height){
+                height = std::max<std::size_t>(height * maxSize / width, 1);
+                width = maxSize;
+            }else{
+                width = std::max<std::size_t>(width * maxSize / height, 1);
+                height = maxSize;
+            }
+        }
+
+        buffer.allocate(header_size + width * height * channels);
+        unsigned char* out = reinterpret_cast<unsigned char*>(buffer.getData());
+        out[0] = width & 0xFF;
+        out[1] = (width >> 8) & 0xFF;
+        out[2] = height & 0xFF;
+        out[3] = (height >> 8) & 0xFF;
+        out[4] = channels & 0xFF;
+        out += header_size;
+
+        const unsigned char* src = pixels.getData();
+        if(width == srcWidth && height == srcHeight){
+            std::memcpy(out, src, width * height * channels);
+            return;
+        }
+
+        for(std::size_t y = 0; y < height; y++){
+            const unsigned char* row = src + (y * srcHeight / height) * srcWidth * channels;
+            for(std::size_t x = 0; x < width; x++){
+                const unsigned char* pixel = row + (x * srcWidth / width) * channels;
+                for(std::size_t c = 0; c < channels; c++)
+                    *out++ = pixel[c];
+            }
+        }
+    }
+
+    ofBuffer packThumbnail(const ofPixels& pixels, std::size_t maxSize){
+        ofBuffer buffer;
+        packThumbnail(pixels, maxSize, buffer);
+        return buffer;
+    }
+
+    bool unpackThumbnail(const ofBuffer& buffer, ofPixels& pixels){
+        if(buffer.size() < header_size)
+            return false;
+
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(buffer.getData());
+        const std::size_t width = in[0] | (in[1] << 8);
+        const std::size_t height = in[2] | (in[3] << 8);
+        const std::size_t channels = in[4];
+        const std::size_t size = width * height * channels;
+        if(size == 0 || buffer.size() != header_size + size)
+            return false;
+
+        if(pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() != channels)
+            pixels.allocate(width, height, channels);
+        std::memcpy(pixels.getData(), in + header_size, size);
+        return true;
+    }
+}
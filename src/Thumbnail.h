@@ -0,0 +1,24 @@
+#pragma once
+#include <graphics/ofPixels.h>
+#include <utils/ofFileUtils.h>
+#include <cstddef>
+
+namespace ossia
+{
+
+/*
+ * Thumbnails of ofPixels, to be sent through a Parameter<ofBuffer>
+ * Layout of the buffer: width and height (16 bits little endian each),
+ * number of channels (8 bits), then the rows of pixels
+ **/
+
+// Downsamples pixels (nearest neighbour) so that their largest side is at most maxSize
+// The result is written directly into buffer, which keeps its allocation from a frame to the next
+void packThumbnail(const ofPixels& pixels, std::size_t maxSize, ofBuffer& buffer);
+
+ofBuffer packThumbnail(const ofPixels& pixels, std::size_t maxSize);
+
+// Returns false, leaving pixels untouched, when buffer does not hold a thumbnail
+bool unpackThumbnail(const ofBuffer& buffer, ofPixels& pixels);
+
+} // namespace ossia
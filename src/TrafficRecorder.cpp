@@ -0,0 +1,424 @@
+//
+//  TrafficRecorder.cpp
+//  ofxOSSIA
+//
+
+#include "TrafficRecorder.h"
+#include "ParamNode.h"
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // Log layout: magic, version, then records
+    // 'A' id size address: an address seen for the first time
+    // 'V' time id value: a value received
+    const char log_magic[4] = {'O', 'F', 'X', 'T'};
+    const uint32_t log_version = 1;
+    const char address_record = 'A';
+    const char value_record = 'V';
+
+    const std::size_t write_threshold = 64 * 1024;
+
+    // Lists of lists: deeper ones are rejected when reading, a corrupted log
+    // could otherwise recurse until the stack overflows
+    const int max_list_depth = 16;
+
+    enum class Tag : uint8_t
+    {
+        Impulse, Int, Float, Bool, Vec2, Vec3, Vec4, String, List
+    };
+
+    template<typename T>
+    void append(std::string& out, const T& v)
+    {
+        out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    void appendValue(std::string& out, const opp::value& v)
+    {
+        if(v.is_float()) { append(out, Tag::Float); append(out, v.to_float()); }
+        else if(v.is_int()) { append(out, Tag::Int); append(out, int32_t(v.to_int())); }
+        else if(v.is_bool()) { append(out, Tag::Bool); append(out, uint8_t(v.to_bool())); }
+        else if(v.is_vec2f()) { append(out, Tag::Vec2); append(out, v.to_vec2f().data); }
+        else if(v.is_vec3f()) { append(out, Tag::Vec3); append(out, v.to_vec3f().data); }
+        else if(v.is_vec4f()) { append(out, Tag::Vec4); append(out, v.to_vec4f().data); }
+        else if(v.is_string())
+        {
+            const std::string s = v.to_string();
+            append(out, Tag::String);
+            append(out, uint32_t(s.size()));
+            out.append(s);
+        }
+        else if(v.is_list())
+        {
+            const std::vector<opp::value> list = v.to_list();
+            append(out, Tag::List);
+            append(out, uint32_t(list.size()));
+            for(const opp::value& element : list)
+                appendValue(out, element);
+        }
+        else
+        {
+            append(out, Tag::Impulse);
+        }
+    }
+
+    // Reads from a log in memory, every read fails once past the end
+    struct Reader
+    {
+        const char* it;
+        const char* end;
+
+        template<typename T>
+        bool read(T& v)
+        {
+            if(std::size_t(end - it) < sizeof(T))
+                return false;
+            std::memcpy(&v, it, sizeof(T));
+            it += sizeof(T);
+            return true;
+        }
+
+        bool read(std::string& s, std::size_t size)
+        {
+            if(std::size_t(end - it) < size)
+                return false;
+            s.assign(it, size);
+            it += size;
+            return true;
+        }
+
+        bool readValue(opp::value& v, int depth = 0)
+        {
+            Tag tag;
+            if(!read(tag))
+                return false;
+
+            switch(tag)
+            {
+                case Tag::Impulse: v = opp::value(opp::value::impulse{}); return true;
+                case Tag::Int: { int32_t i; if(!read(i)) return false; v = opp::value(int(i)); return true; }
+                case Tag::Float: { float f; if(!read(f)) return false; v = opp::value(f); return true; }
+                case Tag::Bool: { uint8_t b; if(!read(b)) return false; v = opp::value(b != 0); return true; }
+                case Tag::Vec2: { opp::value::vec2f w; if(!read(w.data)) return false; v = opp::value(w); return true; }
+                case Tag::Vec3: { opp::value::vec3f w; if(!read(w.data)) return false; v = opp::value(w); return true; }
+                case Tag::Vec4: { opp::value::vec4f w; if(!read(w.data)) return false; v = opp::value(w); return true; }
+                case Tag::String:
+                {
+                    uint32_t size;
+                    std::string s;
+                    if(!read(size) || !read(s, size)) return false;
+                    v = opp::value(std::move(s));
+                    return true;
+                }
+                case Tag::List:
+                {
+                    uint32_t size;
+                    if(depth >= max_list_depth || !read(size) || std::size_t(end - it) < size) // at least one byte per element
+                        return false;
+                    std::vector<opp::value> list(size);
+                    for(opp::value& element : list)
+                        if(!readValue(element, depth + 1))
+                            return false;
+                    v = opp::value(std::move(list));
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+namespace ossia {
+
+    TrafficRecorder::~TrafficRecorder()
+    {
+        close();
+    }
+
+    bool TrafficRecorder::open(const std::string& path)
+    {
+        close();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _file.open(path, std::ios::binary | std::ios::trunc);
+        if(!_file)
+        {
+            std::cerr << "error [ossia::TrafficRecorder::open()] : can't write " << path << "\n";
+            return false;
+        }
+
+        _buffer.clear();
+        _buffer.append(log_magic, sizeof(log_magic));
+        append(_buffer, log_version);
+        _ids.clear();
+        _nextId = 0;
+        _recorded = 0;
+        _start = std::chrono::steady_clock::now();
+        _open = true;
+        _closing = false;
+        _writer = std::thread([this] { run(); });
+        return true;
+    }
+
+    void TrafficRecorder::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_open)
+                return;
+
+            // what is left goes with the last buffers
+            _full.push_back(std::move(_buffer));
+            _buffer.clear();
+            _open = false;
+            _closing = true;
+        }
+        _wake.notify_one();
+        _writer.join();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _file.close();
+        _ids.clear();
+    }
+
+    bool TrafficRecorder::isOpen() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _open;
+    }
+
+    void TrafficRecorder::record(const ParamNode* node, const opp::value& value)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_open)
+            return;
+
+        const uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - _start).count();
+
+        auto it = _ids.find(node);
+        if(it == _ids.end())
+        {
+            const std::string& address = node->_address.path;
+            it = _ids.emplace(node, _nextId++).first;
+            append(_buffer, address_record);
+            append(_buffer, it->second);
+            append(_buffer, uint32_t(address.size()));
+            _buffer.append(address);
+        }
+
+        append(_buffer, value_record);
+        append(_buffer, time);
+        append(_buffer, it->second);
+        appendValue(_buffer, value);
+        _recorded.fetch_add(1, std::memory_order_relaxed);
+
+        if(_buffer.size() >= write_threshold)
+        {
+            // no file I/O here: the buffer is swapped with one already written
+            _full.push_back(std::move(_buffer));
+            _buffer.clear();
+            if(!_spare.empty())
+            {
+                _buffer.swap(_spare.back());
+                _spare.pop_back();
+            }
+            _wake.notify_one();
+        }
+    }
+
+    void TrafficRecorder::forget(const ParamNode* node)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ids.erase(node);
+    }
+
+    uint64_t TrafficRecorder::getRecordedCount() const
+    {
+        return _recorded.load(std::memory_order_relaxed);
+    }
+
+    void TrafficRecorder::run()
+    {
+        std::vector<std::string> buffers;
+        std::unique_lock<std::mutex> lock(_mutex);
+        for(;;)
+        {
+            _wake.wait(lock, [this] { return !_full.empty() || _closing; });
+            if(_full.empty())
+                return;
+
+            buffers.swap(_full);
+            lock.unlock();
+            for(std::string& buffer : buffers)
+            {
+                if(!_file.write(buffer.data(), buffer.size()))
+                    std::cerr << "error [ossia::TrafficRecorder] : can't write the log\n";
+                buffer.clear();
+            }
+            _file.flush();
+            lock.lock();
+
+            for(std::string& buffer : buffers)
+                _spare.push_back(std::move(buffer));
+            buffers.clear();
+        }
+    }
+
+    TrafficReplayer::~TrafficReplayer()
+    {
+        stop();
+    }
+
+    std::size_t TrafficReplayer::load(const std::string& path, opp::node root)
+    {
+        stop();
+        _nodes.clear();
+        _events.clear();
+        _missing = 0;
+
+        // the whole file in one read
+        std::string data;
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if(!file)
+            {
+                std::cerr << "error [ossia::TrafficReplayer::load()] : can't read " << path << "\n";
+                return 0;
+            }
+            data.resize(std::size_t(file.tellg()));
+            file.seekg(0);
+            file.read(&data[0], data.size());
+        }
+
+        Reader reader{data.data(), data.data() + data.size()};
+        char magic[sizeof(log_magic)];
+        uint32_t version;
+        if(!reader.read(magic) || std::memcmp(magic, log_magic, sizeof(log_magic)) != 0
+           || !reader.read(version) || version != log_version)
+        {
+            std::cerr << "error [ossia::TrafficReplayer::load()] : " << path << " is not a traffic log\n";
+            return 0;
+        }
+
+        while(reader.it != reader.end)
+        {
+            char kind;
+            uint32_t id;
+            if(!reader.read(kind))
+                break;
+
+            if(kind == address_record)
+            {
+                uint32_t size;
+                std::string address;
+                if(!reader.read(id) || !reader.read(size) || !reader.read(address, size))
+                    break;
+                if(id >= _nodes.size())
+                    _nodes.resize(id + 1);
+                // find_child() is relative to root
+                _nodes[id] = root.find_child(address.empty() ? address : address.substr(1));
+            }
+            else if(kind == value_record)
+            {
+                Event event;
+                if(!reader.read(event.time) || !reader.read(id) || !reader.readValue(event.value))
+                    break;
+                if(id < _nodes.size() && _nodes[id])
+                {
+                    event.node = id;
+                    _events.push_back(std::move(event));
+                }
+                else
+                {
+                    _missing++;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if(reader.it != reader.end)
+            std::cerr << "error [ossia::TrafficReplayer::load()] : " << path << " is truncated, replaying up to the last complete value\n";
+        return _events.size();
+    }
+
+    std::size_t TrafficReplayer::run(float speed)
+    {
+        _replayed = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for(const Event& event : _events)
+        {
+            if(speed > 0.f)
+            {
+                const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double, std::nano>(event.time / speed));
+                std::unique_lock<std::mutex> lock(_mutex);
+                if(_wake.wait_until(lock, due, [this] { return !_running; }))
+                    break;
+            }
+            else if(!_running)
+            {
+                break;
+            }
+
+            _nodes[event.node].set_value(event.value);
+            _replayed.fetch_add(1, std::memory_order_relaxed);
+        }
+        return _replayed;
+    }
+
+    std::size_t TrafficReplayer::replay(float speed)
+    {
+        stop();
+        _running = true;
+        const std::size_t replayed = run(speed);
+        _running = false;
+        return replayed;
+    }
+
+    void TrafficReplayer::start(float speed)
+    {
+        stop();
+        _running = true;
+        _thread = std::thread([this, speed] {
+            run(speed);
+            _running = false;
+        });
+    }
+
+    void TrafficReplayer::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+        _wake.notify_all();
+        if(_thread.joinable())
+            _thread.join();
+    }
+
+    bool TrafficReplayer::isRunning() const
+    {
+        return _running;
+    }
+
+    std::size_t TrafficReplayer::size() const
+    {
+        return _events.size();
+    }
+
+    uint64_t TrafficReplayer::getMissingCount() const
+    {
+        return _missing;
+    }
+
+    uint64_t TrafficReplayer::getReplayedCount() const
+    {
+        return _replayed.load(std::memory_order_relaxed);
+    }
+}
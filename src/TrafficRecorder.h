@@ -0,0 +1,127 @@
+#pragma once
+#include <ossia-cpp98.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ossia
+{
+
+class ParamNode;
+
+/*
+ * Log of the values received from the network, for load tests without the controllers
+ * The log is append-only: an address is written the first time it is seen,
+ * then each value with its time (in ns since open()) and the id of its address
+ * A log cut by a crash can still be replayed up to its last complete value
+ * Enabled with ofxOssia::startRecording(), record() is called from the network thread:
+ * it only appends to a buffer, the file is written by a thread of the recorder
+ **/
+
+class TrafficRecorder
+{
+public:
+  TrafficRecorder() = default;
+  ~TrafficRecorder();
+
+  TrafficRecorder(const TrafficRecorder&) = delete;
+  TrafficRecorder& operator=(const TrafficRecorder&) = delete;
+
+  // Starts a new log (the file is truncated)
+  bool open(const std::string& path);
+  // Writes what is left and closes the file
+  void close();
+  bool isOpen() const;
+
+  // A value received by the node, before its conversion
+  void record(const ParamNode* node, const opp::value& value);
+  // The node is going away, its address must not be reused for another one
+  void forget(const ParamNode* node);
+
+  // Values recorded since open()
+  uint64_t getRecordedCount() const;
+
+private:
+  // The writer thread, until close()
+  void run();
+
+  mutable std::mutex _mutex;
+  std::ofstream _file; // only used by the writer thread while open
+  bool _open{false};
+  bool _closing{false};
+  std::string _buffer; // handed to the writer thread every 64 kB
+  std::vector<std::string> _full; // waiting for the writer thread
+  std::vector<std::string> _spare; // written, reused by record()
+  std::thread _writer;
+  std::condition_variable _wake;
+  std::unordered_map<const ParamNode*, uint32_t> _ids;
+  uint32_t _nextId{};
+  std::chrono::steady_clock::time_point _start{};
+  std::atomic<uint64_t> _recorded{0};
+};
+
+/*
+ * Plays a log written by TrafficRecorder back into a local device:
+ * each value is set on the node found at the same address, which calls
+ * the callbacks of the parameters as if the value came from the network
+ **/
+
+class TrafficReplayer
+{
+public:
+  TrafficReplayer() = default;
+  ~TrafficReplayer();
+
+  TrafficReplayer(const TrafficReplayer&) = delete;
+  TrafficReplayer& operator=(const TrafficReplayer&) = delete;
+
+  // Reads the whole log and looks for its addresses under root
+  // (e.g. ofxOssia::get_device().get_root_node())
+  // Returns the number of values that can be replayed
+  std::size_t load(const std::string& path, opp::node root);
+
+  // Replays on this thread, speed being a multiple of the recorded time (0: as fast as possible)
+  // Returns the number of values set
+  std::size_t replay(float speed = 1.f);
+
+  // Same on a thread of its own, until the end of the log or stop()
+  void start(float speed = 1.f);
+  void stop();
+  bool isRunning() const;
+
+  // Values loaded
+  std::size_t size() const;
+  // Values of the log whose address is not in the device
+  uint64_t getMissingCount() const;
+  // Values set by the running or last replay
+  uint64_t getReplayedCount() const;
+
+private:
+  struct Event
+  {
+    uint64_t time; // ns
+    uint32_t node;
+    opp::value value;
+  };
+
+  std::size_t run(float speed);
+
+  std::vector<opp::node> _nodes; // by id of address
+  std::vector<Event> _events;
+  uint64_t _missing{};
+
+  std::thread _thread;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::atomic<bool> _running{false};
+  std::atomic<uint64_t> _replayed{0};
+};
+
+} // namespace ossia
@@ -8,12 +8,53 @@
 //
 
 #include "ofxOssia.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
 
+namespace
+{
+    // Snapshot layout: magic, version, number of values,
+    // then the table of addresses, each prefixed by its size and followed by the type id of its value,
+    // and the values, each prefixed by its size
+    const char snapshot_magic[4] = {'O', 'F', 'X', 'S'};
+    const uint32_t snapshot_version = 2;
+}
+
+struct ofxOssia::StatsNodes
+{
+    opp::node reserved;
+    opp::node inRate;
+    opp::node outRate;
+    opp::node received;
+    opp::node published;
+    opp::node mismatches;
+    opp::node queueDepth;
+    opp::node dropped;
+    opp::node callbackLatency;
+
+    uint64_t lastReceived{};
+    uint64_t lastPublished{};
+    std::chrono::steady_clock::time_point lastUpdate{};
+};
+
+ofxOssia::ofxOssia():
+    _context(std::make_shared<ossia::DeviceContext>()),
+    _device(){
+    _root_node.setup (_device.get_root_node(), default_device_name, _context);
+}
+
+ofxOssia::~ofxOssia()
+{
+    // the parameters may outlive the device and its recorder
+    _context->recorder = nullptr;
+}
 
 void ofxOssia::setup()
 {
     _device.setup(default_device_name, 3456, 5678);
-    _root_node.setup(_device.get_root_node(), default_device_name);
+    _root_node.setup(_device.get_root_node(), default_device_name, _context);
 
 }
 
@@ -23,8 +64,290 @@ void ofxOssia::setup(std::string localname,
 
     // declare a distant program as an OSCQuery device
     _device.setup(localname, localportOSC, localPortWS);
-    _root_node.setup(_device.get_root_node(), localname);
+    _root_node.setup(_device.get_root_node(), localname, _context);
+}
+
+void ofxOssia::setInboundMode(ossia::InboundMode mode)
+{
+    _context->inboundMode = mode;
+}
+
+ossia::InboundMode ofxOssia::getInboundMode() const
+{
+    return _context->inboundMode;
+}
+
+std::size_t ofxOssia::drainInbound()
+{
+    return _context->inbound.drain();
+}
+
+void ofxOssia::beginBatch()
+{
+    _context->batching = true;
+}
+
+std::size_t ofxOssia::flush()
+{
+    return _context->flush();
+}
+
+std::size_t ofxOssia::endBatch()
+{
+    _context->batching = false;
+    return _context->flush();
+}
+
+const ossia::Stats& ofxOssia::getStats() const
+{
+    return _context->stats;
+}
+
+std::size_t ofxOssia::getInboundQueueDepth() const
+{
+    return _context->inbound.size();
+}
+
+void ofxOssia::enableStats(bool enable)
+{
+    _context->timeCallbacks = enable;
+
+    if(enable && !_stats)
+    {
+        _stats.reset(new StatsNodes);
+        auto& s = *_stats;
+
+        s.reserved = _device.get_root_node().create_child("ofxOssia");
+        opp::node stats = s.reserved.create_child("stats");
+        s.inRate = stats.create_float("in_rate");
+        s.outRate = stats.create_float("out_rate");
+        s.received = stats.create_int("received");
+        s.published = stats.create_int("published");
+        s.mismatches = stats.create_int("mismatches");
+        s.queueDepth = stats.create_int("queue_depth");
+        s.dropped = stats.create_int("dropped");
+        s.callbackLatency = stats.create_float("callback_latency");
+
+        for(opp::node* node : {&s.inRate, &s.outRate, &s.received, &s.published,
+                               &s.mismatches, &s.queueDepth, &s.dropped, &s.callbackLatency})
+            node->set_access(opp::Get);
+        s.inRate.set_unit("Hz");
+        s.outRate.set_unit("Hz");
+        s.callbackLatency.set_description("duration of the last remote callback, in microseconds");
+
+        s.lastReceived = ossia::Stats::read(_context->stats.received);
+        s.lastPublished = ossia::Stats::read(_context->stats.published);
+        s.lastUpdate = std::chrono::steady_clock::now();
+    }
+    else if(!enable && _stats)
+    {
+        if(_stats->reserved)
+            _device.get_root_node().remove_child(_stats->reserved.get_name());
+        _stats.reset();
+    }
+}
+
+void ofxOssia::updateStats()
+{
+    // the subtree may have been removed with the children of the root
+    if(!_stats || !_stats->reserved)
+        return;
+
+    auto& s = *_stats;
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - s.lastUpdate).count();
+    if(elapsed < 1.)
+        return;
+
+    const auto& counters = _context->stats;
+    const uint64_t received = ossia::Stats::read(counters.received);
+    const uint64_t published = ossia::Stats::read(counters.published);
+
+    s.inRate.set_value(float((received - s.lastReceived) / elapsed));
+    s.outRate.set_value(float((published - s.lastPublished) / elapsed));
+    s.received.set_value(int(received));
+    s.published.set_value(int(published));
+    s.mismatches.set_value(int(ossia::Stats::read(counters.mismatches)));
+    s.queueDepth.set_value(int(_context->inbound.size()));
+    s.dropped.set_value(int(_context->inbound.dropped()));
+    s.callbackLatency.set_value(float(ossia::Stats::read(counters.callbackNs) / 1000.));
+
+    s.lastReceived = received;
+    s.lastPublished = published;
+    s.lastUpdate = now;
+}
+
+std::size_t ofxOssia::saveSnapshot(const std::string& path) const
+{
+    using namespace ossia::snapshot;
+
+    std::vector<std::pair<std::string, std::pair<ossia::ParamNode*, ossia::DeviceContext::SnapshotEntry>>> entries;
+    entries.reserve(_context->snapshotEntries.size());
+    for(const auto& entry : _context->snapshotEntries)
+    {
+        // nodes torn down are not part of the device anymore
+        if(entry.first->_currentNode)
+            entries.emplace_back(entry.first->_address.path, entry);
+    }
+
+    std::string data;
+    data.append(snapshot_magic, sizeof(snapshot_magic));
+    data.append(reinterpret_cast<const char*>(&snapshot_version), sizeof(snapshot_version));
+    writeSize(entries.size(), data);
+
+    for(const auto& entry : entries)
+    {
+        writeSize(entry.first.size(), data);
+        data.append(entry.first);
+        const uint32_t type = entry.second.second.type;
+        data.append(reinterpret_cast<const char*>(&type), sizeof(type));
+    }
+
+    std::string value;
+    for(const auto& entry : entries)
+    {
+        value.clear();
+        entry.second.second.save(entry.second.first, value);
+        writeSize(value.size(), data);
+        data.append(value);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.write(data.data(), data.size()))
+    {
+        std::cerr << "error [ofxOssia::saveSnapshot()] : can't write " << path << "\n";
+        return 0;
+    }
+    return entries.size();
+}
+
+std::size_t ofxOssia::loadSnapshot(const std::string& path)
+{
+    using namespace ossia::snapshot;
+
+    // the whole file in one read
+    std::string data;
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file)
+        {
+            std::cerr << "error [ofxOssia::loadSnapshot()] : can't read " << path << "\n";
+            return 0;
+        }
+        data.resize(std::size_t(file.tellg()));
+        file.seekg(0);
+        file.read(&data[0], data.size());
+    }
+
+    const char* it = data.data();
+    const char* const end = it + data.size();
+    uint32_t version;
+    std::size_t count;
+    if(data.size() < sizeof(snapshot_magic) + sizeof(version)
+       || std::memcmp(it, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    {
+        std::cerr << "error [ofxOssia::loadSnapshot()] : " << path << " is not a snapshot\n";
+        return 0;
+    }
+    it += sizeof(snapshot_magic);
+    std::memcpy(&version, it, sizeof(version));
+    it += sizeof(version);
+    if(version != snapshot_version || !readSize(it, end, count))
+    {
+        std::cerr << "error [ofxOssia::loadSnapshot()] : unsupported snapshot version\n";
+        return 0;
+    }
+    // each value takes at least the size of its address, its type and its own size
+    if(count > std::size_t(end - it) / (3 * sizeof(uint32_t)))
+    {
+        std::cerr << "error [ofxOssia::loadSnapshot()] : " << path << " is truncated\n";
+        return 0;
+    }
+
+    // the parameters of the device, found by address in its index
+    std::vector<std::pair<ossia::ParamNode*, ossia::DeviceContext::SnapshotEntry>> targets;
+    targets.reserve(count);
+    std::size_t mismatches = 0;
+    for(std::size_t i = 0; i < count; i++)
+    {
+        std::size_t size;
+        uint32_t type;
+        if(!readSize(it, end, size) || std::size_t(end - it) < size + sizeof(type))
+        {
+            std::cerr << "error [ofxOssia::loadSnapshot()] : " << path << " is truncated\n";
+            return 0;
+        }
+        const std::string address(it, size);
+        it += size;
+        std::memcpy(&type, it, sizeof(type));
+        it += sizeof(type);
+
+        // nodes torn down are not part of the device anymore
+        const ossia::AddressIndex::Entry* found = _context->index.find(address);
+        if(found && found->node->_currentNode)
+        {
+            const auto& entry = _context->snapshotEntries[found->node];
+            if(entry.type == type)
+            {
+                targets.emplace_back(found->node, entry);
+                continue;
+            }
+            // the parameter at this address is now of another type
+            found->node->countMismatch();
+            mismatches++;
+        }
+        targets.emplace_back();
+    }
+    if(mismatches)
+        std::cerr << "error [ofxOssia::loadSnapshot()] : " << mismatches << " value(s) of another type skipped\n";
+
+    // one pass over the values, published together
+    ossia::DeviceContext::ScopedBatch batch{_context.get()};
+
+    std::size_t loaded = 0;
+    for(const auto& target : targets)
+    {
+        std::size_t size;
+        if(!readSize(it, end, size) || std::size_t(end - it) < size)
+        {
+            std::cerr << "error [ofxOssia::loadSnapshot()] : " << path << " is truncated\n";
+            break;
+        }
+        if(target.first)
+        {
+            if(target.second.load(target.first, it, size))
+                loaded++;
+            else
+                target.first->countMismatch();
+        }
+        it += size;
+    }
+    return loaded;
 }
 
+bool ofxOssia::startRecording(const std::string& path)
+{
+    if(!_recorder)
+        _recorder.reset(new ossia::TrafficRecorder);
 
+    if(!_recorder->open(path))
+    {
+        _context->recorder = nullptr;
+        return false;
+    }
+    _context->recorder = _recorder.get();
+    return true;
+}
 
+void ofxOssia::stopRecording()
+{
+    // the recorder itself stays: a callback may still be using it
+    _context->recorder = nullptr;
+    if(_recorder)
+        _recorder->close();
+}
+
+bool ofxOssia::isRecording() const
+{
+    return _context->recorder.load() != nullptr;
+}
@@ -6,17 +6,21 @@
 #undef status
 #undef None
 #include <ossia-cpp98.hpp>
+#include <memory>
 #include "Parameter.h"
+#include "ParameterSchema.h"
+#include "Thumbnail.h"
+#include "ofxOssiaMirror.h"
+#include "PresetBank.h"
+#include "TrafficRecorder.h"
 
 #define default_device_name "ofxOssia"
 
 class ofxOssia {
 
 public:
-    ofxOssia():
-        _device(){
-        _root_node.setup (_device.get_root_node(), default_device_name);
-    }
+    ofxOssia();
+    ~ofxOssia();
 
     /**
      * default setup for ofxOssia. Create a root node with oscquery protocol on port 3456 for OSC and 5678 for WS
@@ -33,13 +37,91 @@ public:
     ossia::ParameterGroup & get_root_node(){return _root_node;}
     opp::oscquery_server & get_device(){return _device;}
 
-//    ossia::ParameterGroup & getNode(std::string & name);
-//    ossia::Parameter & getNode(std::string & name);
+    /**
+     * With InboundMode::Queued, values received from the network are not applied
+     * on the network thread anymore but queued until drainInbound() is called
+     **/
+    void setInboundMode(ossia::InboundMode mode);
+    ossia::InboundMode getInboundMode() const;
+
+    /**
+     * Applies the queued remote values and the latest value of coalesced parameters,
+     * to be called from the main thread (e.g. in ofApp::update())
+     * Returns the number of values applied
+     **/
+    std::size_t drainInbound();
+
+    /**
+     * Between beginBatch() and endBatch(), local changes are not sent immediately:
+     * each changed parameter is published once by the next flush()
+     * flush() also sends the changes held back by Parameter::setMaxRate()
+     * Meant to be used with InboundMode::Queued, so that every change happens on the main thread
+     **/
+    void beginBatch();
+    std::size_t flush();
+    std::size_t endBatch();
+
+    /**
+     * Counters of the whole device: values received and sent, type mismatches,
+     * duration of the last remote callback (when stats are enabled)
+     **/
+    const ossia::Stats& getStats() const;
+    std::size_t getInboundQueueDepth() const;
+
+    /**
+     * Publishes the device counters under the reserved /ofxOssia/stats subtree
+     * (in/out rates, totals, mismatches, inbound queue depth and drops, callback latency)
+     * and starts timing the remote callbacks
+     * updateStats() refreshes the published values, at most once per second
+     **/
+    void enableStats(bool enable);
+    void updateStats();
+
+    /**
+     * Saves the value of every parameter of the device in a binary file:
+     * a table of the addresses, then the values
+     * loadSnapshot() reads the file at once and sets the parameters found at the same
+     * addresses, in a batch published at the end (or by the next flush() if already batching)
+     * Returns the number of values saved / loaded
+     **/
+    std::size_t saveSnapshot(const std::string& path) const;
+    std::size_t loadSnapshot(const std::string& path);
+
+    /**
+     * Logs every value received from the network (address, value, time) in a binary file,
+     * to be replayed later with an ossia::TrafficReplayer, e.g. for load tests
+     * Recording costs a lock and a copy of the value in the network thread
+     **/
+    bool startRecording(const std::string& path);
+    void stopRecording();
+    bool isRecording() const;
+
+    /**
+     * The parameter at this address (e.g. "/circle/radius"), in constant time:
+     * the device keeps an index of its parameters, filled by Parameter::setup()
+     * Returns nullptr if there is none, if it is of another type or if its node was torn down
+     * The ofParameter returned shares the value of the ossia::Parameter: setting it publishes
+     * An ossia::Address kept from one frame to the next also saves hashing the address
+     **/
+    template<typename DataValue>
+    ofParameter<DataValue>* find(const ossia::Address& address) const
+    {
+        const ossia::AddressIndex::Entry* entry = _context->index.find(address);
+        if(!entry || *entry->type != typeid(DataValue) || !entry->node->_currentNode)
+            return nullptr;
+        return static_cast<ofParameter<DataValue>*>(entry->parameter);
+    }
 
 
 private:
 
+    struct StatsNodes;
+
+    // destroyed last: the network thread may still be recording until _device is gone
+    std::unique_ptr<ossia::TrafficRecorder> _recorder;
+    std::shared_ptr<ossia::DeviceContext> _context;
     ossia::ParameterGroup _root_node;
     opp::oscquery_server _device;
+    std::unique_ptr<StatsNodes> _stats;
 
 };
@@ -0,0 +1,378 @@
+//
+//  ofxOssiaMirror.cpp
+//  ofxOSSIA
+//
+
+#include "ofxOssiaMirror.h"
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    std::string parentAddress(const std::string& address)
+    {
+        return address.substr(0, address.rfind('/'));
+    }
+}
+
+struct ofxOssiaMirror::Tree
+{
+    // ofx type materializing a remote node
+    enum class Kind
+    {
+        None,       // no parameter that can be mirrored (e.g. impulse)
+        Group,      // no parameter
+        Float, Int, Bool, Vec2, Vec3, Vec4,
+        Color, FloatColor, Quaternion,
+        String, FloatList, IntList
+    };
+
+    static Kind kindOf(const opp::node& node)
+    {
+        if(!node.has_parameter())
+            return Kind::Group;
+
+        const opp::value v = node.get_value();
+        if(v.is_float()) return Kind::Float;
+        if(v.is_int()) return Kind::Int;
+        if(v.is_bool()) return Kind::Bool;
+        if(v.is_vec2f()) return Kind::Vec2;
+        if(v.is_vec3f()) return Kind::Vec3;
+        if(v.is_string()) return Kind::String;
+        if(v.is_vec4f())
+        {
+            // same units as MatchingType<ofColor> (rgba) and MatchingType<ofFloatColor> (argb)
+            const std::string unit = node.get_unit();
+            if(unit.find("rgba") != std::string::npos) return Kind::Color;
+            if(unit.find("argb") != std::string::npos) return Kind::FloatColor;
+            if(unit.find("quaternion") != std::string::npos) return Kind::Quaternion;
+            return Kind::Vec4;
+        }
+        if(v.is_list())
+        {
+            const std::vector<opp::value> list = v.to_list();
+            bool ints = !list.empty();
+            for(const opp::value& element : list)
+            {
+                if(element.is_float())
+                    ints = false;
+                else if(!element.is_int())
+                    return Kind::None;
+            }
+            return ints ? Kind::IntList : Kind::FloatList;
+        }
+        return Kind::None;
+    }
+
+    struct Entry
+    {
+        opp::node node;
+        Kind kind{Kind::None};
+        std::string parent;
+        // a node can have a parameter and children at the same time
+        std::unique_ptr<ossia::ParameterGroup> group;
+        std::unique_ptr<ofAbstractParameter> parameter;
+        void (*rebind)(ofAbstractParameter&, opp::node){};
+        uint64_t seen{0}; // last update() that found the node
+    };
+
+    ossia::ParameterGroup& root;
+    std::unordered_map<std::string, Entry> entries;
+
+    // state of update(), kept from a call to the next to reuse the buffers
+    uint64_t generation{0};
+    std::vector<std::pair<std::string, opp::node>> changed;
+    std::vector<std::string> gone;
+
+    explicit Tree(ossia::ParameterGroup& r): root(r) { }
+
+    ~Tree()
+    {
+        // children before their parents
+        std::vector<std::string> keys;
+        keys.reserve(entries.size());
+        for(const auto& entry : entries)
+            keys.push_back(entry.first);
+        std::sort(keys.begin(), keys.end());
+        for(auto it = keys.rbegin(); it != keys.rend(); ++it)
+            remove(*it);
+    }
+
+    template<typename DataValue>
+    static void rebindParameter(ofAbstractParameter& parameter, opp::node node)
+    {
+        static_cast<ossia::Parameter<DataValue>&>(parameter).rebind(node);
+    }
+
+    template<typename DataValue>
+    void attach(Entry& entry, ossia::ParameterGroup& parent)
+    {
+        auto param = new ossia::Parameter<DataValue>;
+        entry.parameter.reset(param);
+        entry.rebind = &rebindParameter<DataValue>;
+        param->attach(parent, entry.node);
+    }
+
+    // Group of the children of the node at address, created if needed
+    ossia::ParameterGroup& groupOf(const std::string& address)
+    {
+        if(address.empty())
+            return root;
+
+        auto it = entries.find(address);
+        if(it == entries.end())
+            return root; // parents are always added first, but the server might be odd
+
+        Entry& entry = it->second;
+        if(!entry.group)
+        {
+            ossia::ParameterGroup& parent = groupOf(entry.parent);
+            entry.group.reset(new ossia::ParameterGroup);
+            entry.group->attach(parent, entry.node);
+        }
+        return *entry.group;
+    }
+
+    void materialize(const std::string& address, Entry& entry)
+    {
+        if(entry.kind == Kind::Group)
+        {
+            groupOf(address);
+            return;
+        }
+
+        ossia::ParameterGroup& parent = groupOf(entry.parent);
+        switch(entry.kind)
+        {
+            case Kind::Float: attach<float>(entry, parent); break;
+            case Kind::Int: attach<int>(entry, parent); break;
+            case Kind::Bool: attach<bool>(entry, parent); break;
+            case Kind::Vec2: attach<ofVec2f>(entry, parent); break;
+            case Kind::Vec3: attach<ofVec3f>(entry, parent); break;
+            case Kind::Vec4: attach<ofVec4f>(entry, parent); break;
+            case Kind::Color: attach<ofColor>(entry, parent); break;
+            case Kind::FloatColor: attach<ofFloatColor>(entry, parent); break;
+            case Kind::Quaternion: attach<glm::quat>(entry, parent); break;
+            case Kind::String: attach<std::string>(entry, parent); break;
+            case Kind::FloatList: attach<std::vector<float>>(entry, parent); break;
+            case Kind::IntList: attach<std::vector<int>>(entry, parent); break;
+            case Kind::Group:
+            case Kind::None: break;
+        }
+    }
+
+    void add(const std::string& address, opp::node node, uint64_t generation)
+    {
+        Entry& entry = entries[address];
+        entry.node = std::move(node);
+        entry.seen = generation;
+        entry.kind = kindOf(entry.node);
+        entry.parent = parentAddress(address);
+        materialize(address, entry);
+    }
+
+    // The parameter only: children keep their group
+    void removeParameter(Entry& entry)
+    {
+        if(!entry.parameter)
+            return;
+        auto parent = entries.find(entry.parent);
+        if(parent == entries.end() || !parent->second.group)
+            root.remove(*entry.parameter);
+        else
+            parent->second.group->remove(*entry.parameter);
+        entry.parameter.reset();
+        entry.rebind = nullptr;
+    }
+
+    void remove(const std::string& address)
+    {
+        auto it = entries.find(address);
+        if(it == entries.end())
+            return;
+
+        Entry& entry = it->second;
+        removeParameter(entry);
+        if(entry.group)
+            entry.group->teardown();
+        entries.erase(it);
+    }
+
+    // The node at this address is still there, but the refresh may have replaced it
+    // Returns true if the parameter had to be created again
+    bool replace(const std::string& address, Entry& entry, opp::node node)
+    {
+        if(entry.node)
+            return false;
+
+        entry.node = std::move(node);
+        // the children are rebound afterwards, under the new node
+        if(entry.group)
+            entry.group->rebind(entry.node);
+
+        const Kind kind = kindOf(entry.node);
+        if(kind == entry.kind)
+        {
+            if(entry.rebind)
+                entry.rebind(*entry.parameter, entry.node);
+            return false;
+        }
+
+        removeParameter(entry);
+        entry.kind = kind;
+        materialize(address, entry);
+        return true;
+    }
+};
+
+ofxOssiaMirror::ofxOssiaMirror():
+    _context(std::make_shared<ossia::DeviceContext>()){
+}
+
+ofxOssiaMirror::~ofxOssiaMirror() = default;
+
+void ofxOssiaMirror::setup(std::string name, std::string host)
+{
+    _tree.reset();
+    _name = std::move(name);
+    _host = std::move(host);
+
+    // declare a distant program as an OSCQuery device
+    _mirror.reset(new opp::oscquery_mirror(_name, _host));
+    _root_node.setup(_mirror->get_root_node(), _name, _context);
+    _tree.reset(new Tree(_root_node));
+    update();
+}
+
+std::size_t ofxOssiaMirror::refresh()
+{
+    if(!_mirror)
+        return 0;
+
+    _mirror->refresh();
+    return update();
+}
+
+std::size_t ofxOssiaMirror::reconnect()
+{
+    if(!_mirror)
+        return 0;
+
+    _mirror->reconnect(_name, _host);
+    return refresh();
+}
+
+std::size_t ofxOssiaMirror::update()
+{
+    // The C++98 API has no notification of the nodes added or removed, nor a version
+    // of the namespace: the whole namespace is walked once, each address looked up in the tree,
+    // and only what changed is sorted and applied
+    Tree& tree = *_tree;
+    const uint64_t generation = ++tree.generation;
+    tree.changed.clear();
+    tree.gone.clear();
+
+    for(opp::node& node : _mirror->get_root_node().get_namespace())
+    {
+        std::string address = ossia::relativeAddress(node.get_address());
+        if(address.empty())
+            continue;
+
+        auto it = tree.entries.find(address);
+        if(it != tree.entries.end())
+        {
+            it->second.seen = generation;
+            // the refresh did not replace this node
+            if(it->second.node)
+                continue;
+        }
+        tree.changed.emplace_back(std::move(address), std::move(node));
+    }
+
+    for(const auto& entry : tree.entries)
+    {
+        if(entry.second.seen != generation)
+            tree.gone.push_back(entry.first);
+    }
+
+    if(tree.changed.empty() && tree.gone.empty())
+        return 0;
+
+    std::size_t changes = 0;
+
+    // what is gone, children first
+    std::sort(tree.gone.begin(), tree.gone.end());
+    for(auto it = tree.gone.rbegin(); it != tree.gone.rend(); ++it)
+    {
+        tree.remove(*it);
+        changes++;
+    }
+
+    // what is new or was replaced, parents first
+    std::sort(tree.changed.begin(), tree.changed.end(),
+              [] (const std::pair<std::string, opp::node>& a, const std::pair<std::string, opp::node>& b) {
+        return a.first < b.first;
+    });
+    for(auto& node : tree.changed)
+    {
+        auto it = tree.entries.find(node.first);
+        if(it == tree.entries.end())
+        {
+            tree.add(node.first, std::move(node.second), generation);
+            changes++;
+        }
+        else if(tree.replace(node.first, it->second, std::move(node.second)))
+        {
+            changes++;
+        }
+    }
+    tree.changed.clear();
+    return changes;
+}
+
+ofAbstractParameter* ofxOssiaMirror::findParameter(const std::string& address)
+{
+    if(!_tree)
+        return nullptr;
+
+    auto it = _tree->entries.find(address.empty() || address[0] == '/' ? address : ossia::relativeAddress(address));
+    return it != _tree->entries.end() ? it->second.parameter.get() : nullptr;
+}
+
+void ofxOssiaMirror::setInboundMode(ossia::InboundMode mode)
+{
+    _context->inboundMode = mode;
+}
+
+ossia::InboundMode ofxOssiaMirror::getInboundMode() const
+{
+    return _context->inboundMode;
+}
+
+std::size_t ofxOssiaMirror::drainInbound()
+{
+    return _context->inbound.drain();
+}
+
+void ofxOssiaMirror::beginBatch()
+{
+    _context->batching = true;
+}
+
+std::size_t ofxOssiaMirror::flush()
+{
+    return _context->flush();
+}
+
+std::size_t ofxOssiaMirror::endBatch()
+{
+    _context->batching = false;
+    return _context->flush();
+}
+
+const ossia::Stats& ofxOssiaMirror::getStats() const
+{
+    return _context->stats;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#undef Status
+#undef Bool
+#undef bool
+#undef False
+#undef status
+#undef None
+#include <ossia-cpp98.hpp>
+#include <memory>
+#include <string>
+#include "Parameter.h"
+
+/*
+ * Mirror of a remote OSCQuery device (another ofxOssia app, score...)
+ * The remote namespace is materialized as an ossia::ParameterGroup tree of ossia::Parameter,
+ * which can be added to a GUI and changed like local parameters
+ **/
+
+class ofxOssiaMirror {
+
+public:
+    ofxOssiaMirror();
+    ~ofxOssiaMirror();
+
+    /**
+     * Connects to the server (e.g. "ws://127.0.0.1:5678") and builds the tree
+     **/
+    void setup(std::string name, std::string host = "ws://127.0.0.1:5678");
+
+    /**
+     * Asks the server for its namespace again and updates the tree:
+     * only the nodes added, removed or replaced are touched,
+     * the other parameters (and their listeners) are kept
+     * Returns the number of parameters and groups added or removed
+     **/
+    std::size_t refresh();
+
+    /**
+     * Connects again with the name and host given to setup(), then refreshes
+     **/
+    std::size_t reconnect();
+
+    ossia::ParameterGroup & get_root_node(){return _root_node;}
+
+    /**
+     * The parameter mirroring the remote address (e.g. "/circle/radius"),
+     * nullptr if there is none or if it is not of this type
+     **/
+    template<typename DataValue>
+    ossia::Parameter<DataValue>* getParameter(const std::string& address)
+    {
+        return dynamic_cast<ossia::Parameter<DataValue>*>(findParameter(address));
+    }
+
+    /**
+     * Same as in ofxOssia
+     **/
+    void setInboundMode(ossia::InboundMode mode);
+    ossia::InboundMode getInboundMode() const;
+    std::size_t drainInbound();
+
+    void beginBatch();
+    std::size_t flush();
+    std::size_t endBatch();
+
+    const ossia::Stats& getStats() const;
+
+private:
+    struct Tree;
+
+    ofAbstractParameter* findParameter(const std::string& address);
+    std::size_t update();
+
+    std::string _name;
+    std::string _host;
+    std::shared_ptr<ossia::DeviceContext> _context;
+    std::unique_ptr<opp::oscquery_mirror> _mirror;
+    ossia::ParameterGroup _root_node;
+    std::unique_ptr<Tree> _tree;
+};